@@ -257,81 +257,52 @@ dctool_xml_output_write (dctool_output_t *abstract, dc_parser_t *parser, const u
 			dt.timezone / 3600, (abs(dt.timezone) % 3600) / 60);
 	}
 
-	// Parse the divetime.
-	message ("Parsing the divetime.\n");
-	unsigned int divetime = 0;
-	status = dc_parser_get_field (parser, DC_FIELD_DIVETIME, 0, &divetime);
+	// Parse the summary.
+	message ("Parsing the summary.\n");
+	dc_summary_t summary;
+	status = dc_parser_get_summary (parser, &summary);
 	if (status != DC_STATUS_SUCCESS && status != DC_STATUS_UNSUPPORTED) {
-		ERROR ("Error parsing the divetime.");
+		ERROR ("Error parsing the summary.");
 		goto cleanup;
 	}
 
 	fprintf (output->ostream, "<divetime>%02u:%02u</divetime>\n",
-		divetime / 60, divetime % 60);
-
-	// Parse the maxdepth.
-	message ("Parsing the maxdepth.\n");
-	double maxdepth = 0.0;
-	status = dc_parser_get_field (parser, DC_FIELD_MAXDEPTH, 0, &maxdepth);
-	if (status != DC_STATUS_SUCCESS && status != DC_STATUS_UNSUPPORTED) {
-		ERROR ("Error parsing the maxdepth.");
-		goto cleanup;
-	}
+		summary.divetime / 60, summary.divetime % 60);
 
 	fprintf (output->ostream, "<maxdepth>%.2f</maxdepth>\n",
-		convert_depth(maxdepth, output->units));
-
-	// Parse the avgdepth.
-	message ("Parsing the avgdepth.\n");
-	double avgdepth = 0.0;
-	status = dc_parser_get_field (parser, DC_FIELD_AVGDEPTH, 0, &avgdepth);
-	if (status != DC_STATUS_SUCCESS && status != DC_STATUS_UNSUPPORTED) {
-		ERROR ("Error parsing the avgdepth.");
-		goto cleanup;
-	}
+		convert_depth(summary.maxdepth, output->units));
 
-	if (status != DC_STATUS_UNSUPPORTED) {
+	if (summary.fields & DC_FIELD_MASK(DC_FIELD_AVGDEPTH)) {
 		fprintf (output->ostream, "<avgdepth>%.2f</avgdepth>\n",
-			convert_depth(avgdepth, output->units));
+			convert_depth(summary.avgdepth, output->units));
 	}
 
-	// Parse the temperature.
-	message ("Parsing the temperature.\n");
 	for (unsigned int i = 0; i < 3; ++i) {
 		dc_field_type_t fields[] = {DC_FIELD_TEMPERATURE_SURFACE,
 			DC_FIELD_TEMPERATURE_MINIMUM,
 			DC_FIELD_TEMPERATURE_MAXIMUM};
+		double temperatures[] = {summary.temperature_surface,
+			summary.temperature_minimum,
+			summary.temperature_maximum};
 		const char *names[] = {"surface", "minimum", "maximum"};
 
-		double temperature = 0.0;
-		status = dc_parser_get_field (parser, fields[i], 0, &temperature);
-		if (status != DC_STATUS_SUCCESS && status != DC_STATUS_UNSUPPORTED) {
-			ERROR ("Error parsing the temperature.");
-			goto cleanup;
-		}
-
-		if (status != DC_STATUS_UNSUPPORTED) {
+		if (summary.fields & DC_FIELD_MASK(fields[i])) {
 			fprintf (output->ostream, "<temperature type=\"%s\">%.1f</temperature>\n",
 				names[i],
-				convert_temperature(temperature, output->units));
+				convert_temperature(temperatures[i], output->units));
 		}
 	}
 
-	// Parse the gas mixes.
-	message ("Parsing the gas mixes.\n");
-	unsigned int ngases = 0;
-	status = dc_parser_get_field (parser, DC_FIELD_GASMIX_COUNT, 0, &ngases);
-	if (status != DC_STATUS_SUCCESS && status != DC_STATUS_UNSUPPORTED) {
-		ERROR ("Error parsing the gas mix count.");
-		goto cleanup;
-	}
-
-	for (unsigned int i = 0; i < ngases; ++i) {
+	for (unsigned int i = 0; i < summary.ngasmixes; ++i) {
 		dc_gasmix_t gasmix = {0};
-		status = dc_parser_get_field (parser, DC_FIELD_GASMIX, i, &gasmix);
-		if (status != DC_STATUS_SUCCESS && status != DC_STATUS_UNSUPPORTED) {
-			ERROR ("Error parsing the gas mix.");
-			goto cleanup;
+		if (i < DC_SUMMARY_MAXGASMIXES) {
+			gasmix = summary.gasmix[i];
+		} else {
+			status = dc_parser_get_field (parser, DC_FIELD_GASMIX, i, &gasmix);
+			if (status != DC_STATUS_SUCCESS && status != DC_STATUS_UNSUPPORTED) {
+				ERROR ("Error parsing the gas mix.");
+				goto cleanup;
+			}
 		}
 
 		fprintf (output->ostream,
@@ -353,23 +324,18 @@ dctool_xml_output_write (dctool_output_t *abstract, dc_parser_t *parser, const u
 
 	}
 
-	// Parse the tanks.
-	message ("Parsing the tanks.\n");
-	unsigned int ntanks = 0;
-	status = dc_parser_get_field (parser, DC_FIELD_TANK_COUNT, 0, &ntanks);
-	if (status != DC_STATUS_SUCCESS && status != DC_STATUS_UNSUPPORTED) {
-		ERROR ("Error parsing the tank count.");
-		goto cleanup;
-	}
-
-	for (unsigned int i = 0; i < ntanks; ++i) {
+	for (unsigned int i = 0; i < summary.ntanks; ++i) {
 		const char *names[] = {"none", "metric", "imperial"};
 
 		dc_tank_t tank = {0};
-		status = dc_parser_get_field (parser, DC_FIELD_TANK, i, &tank);
-		if (status != DC_STATUS_SUCCESS && status != DC_STATUS_UNSUPPORTED) {
-			ERROR ("Error parsing the tank.");
-			goto cleanup;
+		if (i < DC_SUMMARY_MAXTANKS) {
+			tank = summary.tank[i];
+		} else {
+			status = dc_parser_get_field (parser, DC_FIELD_TANK, i, &tank);
+			if (status != DC_STATUS_SUCCESS && status != DC_STATUS_UNSUPPORTED) {
+				ERROR ("Error parsing the tank.");
+				goto cleanup;
+			}
 		}
 
 		fprintf (output->ostream, "<tank>\n");
@@ -401,98 +367,54 @@ dctool_xml_output_write (dctool_output_t *abstract, dc_parser_t *parser, const u
 			convert_pressure(tank.endpressure, output->units));
 	}
 
-	// Parse the dive mode.
-	message ("Parsing the dive mode.\n");
-	dc_divemode_t divemode = DC_DIVEMODE_OC;
-	status = dc_parser_get_field (parser, DC_FIELD_DIVEMODE, 0, &divemode);
-	if (status != DC_STATUS_SUCCESS && status != DC_STATUS_UNSUPPORTED) {
-		ERROR ("Error parsing the dive mode.");
-		goto cleanup;
-	}
-
-	if (status != DC_STATUS_UNSUPPORTED) {
+	if (summary.fields & DC_FIELD_MASK(DC_FIELD_DIVEMODE)) {
 		const char *names[] = {"freedive", "gauge", "oc", "ccr", "scr"};
 		fprintf (output->ostream, "<divemode>%s</divemode>\n",
-			names[divemode]);
-	}
-
-	// Parse the deco model.
-	message ("Parsing the deco model.\n");
-	dc_decomodel_t decomodel = {DC_DECOMODEL_NONE};
-	status = dc_parser_get_field (parser, DC_FIELD_DECOMODEL, 0, &decomodel);
-	if (status != DC_STATUS_SUCCESS && status != DC_STATUS_UNSUPPORTED) {
-		ERROR ("Error parsing the deco model.");
-		goto cleanup;
+			names[summary.divemode]);
 	}
 
-	if (status != DC_STATUS_UNSUPPORTED) {
+	if (summary.fields & DC_FIELD_MASK(DC_FIELD_DECOMODEL)) {
+		const dc_decomodel_t *decomodel = &summary.decomodel;
 		const char *names[] = {"none", "buhlmann", "vpm", "rgbm", "dciem"};
 		fprintf (output->ostream, "<decomodel>%s</decomodel>\n",
-			names[decomodel.type]);
-		if (decomodel.type == DC_DECOMODEL_BUHLMANN &&
-			(decomodel.params.gf.low != 0 || decomodel.params.gf.high != 0)) {
+			names[decomodel->type]);
+		if (decomodel->type == DC_DECOMODEL_BUHLMANN &&
+			(decomodel->params.gf.low != 0 || decomodel->params.gf.high != 0)) {
 			fprintf (output->ostream, "<gf>%u/%u</gf>\n",
-				decomodel.params.gf.low, decomodel.params.gf.high);
+				decomodel->params.gf.low, decomodel->params.gf.high);
 		}
-		if (decomodel.conservatism) {
+		if (decomodel->conservatism) {
 			fprintf (output->ostream, "<conservatism>%d</conservatism>\n",
-				decomodel.conservatism);
+				decomodel->conservatism);
 		}
 	}
 
-	// Parse the salinity.
-	message ("Parsing the salinity.\n");
-	dc_salinity_t salinity = {DC_WATER_FRESH, 0.0};
-	status = dc_parser_get_field (parser, DC_FIELD_SALINITY, 0, &salinity);
-	if (status != DC_STATUS_SUCCESS && status != DC_STATUS_UNSUPPORTED) {
-		ERROR ("Error parsing the salinity.");
-		goto cleanup;
-	}
-
-	if (status != DC_STATUS_UNSUPPORTED) {
+	if (summary.fields & DC_FIELD_MASK(DC_FIELD_SALINITY)) {
 		const char *names[] = {"fresh", "salt"};
-		if (salinity.density) {
+		if (summary.salinity.density) {
 			fprintf (output->ostream, "<salinity density=\"%.1f\">%s</salinity>\n",
-				salinity.density, names[salinity.type]);
+				summary.salinity.density, names[summary.salinity.type]);
 		} else {
 			fprintf (output->ostream, "<salinity>%s</salinity>\n",
-				names[salinity.type]);
+				names[summary.salinity.type]);
 		}
 	}
 
-	// Parse the atmospheric pressure.
-	message ("Parsing the atmospheric pressure.\n");
-	double atmospheric = 0.0;
-	status = dc_parser_get_field (parser, DC_FIELD_ATMOSPHERIC, 0, &atmospheric);
-	if (status != DC_STATUS_SUCCESS && status != DC_STATUS_UNSUPPORTED) {
-		ERROR ("Error parsing the atmospheric pressure.");
-		goto cleanup;
-	}
-
-	if (status != DC_STATUS_UNSUPPORTED) {
+	if (summary.fields & DC_FIELD_MASK(DC_FIELD_ATMOSPHERIC)) {
 		fprintf (output->ostream, "<atmospheric>%.5f</atmospheric>\n",
-			convert_pressure(atmospheric, output->units));
-	}
-
-	// Parse the GPS location.
-	message ("Parsing the GPS location.\n");
-	dc_location_t location = {0};
-	status = dc_parser_get_field (parser, DC_FIELD_LOCATION, 0, &location);
-	if (status != DC_STATUS_SUCCESS && status != DC_STATUS_UNSUPPORTED) {
-		ERROR ("Error parsing the GPS location.");
-		goto cleanup;
+			convert_pressure(summary.atmospheric, output->units));
 	}
 
-	if (status != DC_STATUS_UNSUPPORTED) {
+	if (summary.fields & DC_FIELD_MASK(DC_FIELD_LOCATION)) {
 		fprintf (output->ostream,
 			"<location>\n"
 			"   <latitude>%.6f<latitude>\n"
 			"   <longitude>%.6f</longitude>\n"
 			"   <altitude>%.2f<altitude>\n"
 			"</location>\n",
-			location.latitude,
-			location.longitude,
-			convert_depth(location.altitude, output->units));
+			summary.location.latitude,
+			summary.location.longitude,
+			convert_depth(summary.location.altitude, output->units));
 	}
 
 	// Parse the sample data.
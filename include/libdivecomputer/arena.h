@@ -0,0 +1,86 @@
+/*
+ * libdivecomputer
+ *
+ * Copyright (C) 2023 Jules
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+#ifndef DC_ARENA_H
+#define DC_ARENA_H
+
+#include <stddef.h>
+
+#include "common.h"
+#include "context.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/*
+ * Arena allocator
+ *
+ * An arena hands out memory from large blocks, by simply advancing a
+ * pointer. Releasing memory does nothing, except for the most recent
+ * allocation. Instead, all the memory is released at once by resetting
+ * the arena, for example after every dive:
+ *
+ *   dc_arena_get_allocator (arena, &allocator);
+ *   dc_context_set_allocator (context, &allocator);
+ *
+ *   for (every dive) {
+ *       dc_parser_new2 (&parser, context, descriptor, data, size);
+ *       ...
+ *       dc_parser_destroy (parser);
+ *       dc_arena_reset (arena);
+ *   }
+ *
+ * After a reset, the arena keeps a single block, large enough for all the
+ * memory that was in use, so the next dives of a similar size allocate
+ * nothing from the system. An arena is not thread-safe.
+ */
+typedef struct dc_arena_t dc_arena_t;
+
+/*
+ * Create an arena. The blocksize is the minimum size of the blocks that
+ * are allocated from the system, or zero for the default size.
+ */
+dc_status_t
+dc_arena_new (dc_arena_t **arena, size_t blocksize);
+
+/*
+ * Release all the memory allocated from the arena. Any object that is
+ * still using it must not be used anymore.
+ */
+dc_status_t
+dc_arena_reset (dc_arena_t *arena);
+
+dc_status_t
+dc_arena_free (dc_arena_t *arena);
+
+/*
+ * Get an allocator for dc_context_set_allocator(), allocating from the
+ * arena. The arena must outlive the context, or the allocator must be
+ * replaced first.
+ */
+dc_status_t
+dc_arena_get_allocator (dc_arena_t *arena, dc_allocator_t *allocator);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+#endif /* DC_ARENA_H */
@@ -24,15 +24,32 @@
 
 #include <stddef.h>
 
+#include "context.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif /* __cplusplus */
 
 typedef struct dc_buffer_t dc_buffer_t;
 
+/*
+ * A read-only part of a buffer.
+ */
+typedef struct dc_buffer_view_t {
+	const unsigned char *data;
+	size_t size;
+} dc_buffer_view_t;
+
 dc_buffer_t *
 dc_buffer_new (size_t capacity);
 
+/*
+ * Same as dc_buffer_new(), except that the memory is allocated with the
+ * allocator of the context (see dc_context_set_allocator).
+ */
+dc_buffer_t *
+dc_buffer_new2 (dc_context_t *context, size_t capacity);
+
 void
 dc_buffer_free (dc_buffer_t *buffer);
 
@@ -48,6 +65,19 @@ dc_buffer_resize (dc_buffer_t *buffer, size_t size);
 int
 dc_buffer_append (dc_buffer_t *buffer, const unsigned char data[], size_t size);
 
+/*
+ * Appending without an intermediate copy. The prepare function returns a
+ * pointer to at least size writable bytes at the end of the buffer (or
+ * NULL on failure), and the commit function adds the first size bytes
+ * that were actually written to the buffer. The pointer remains valid
+ * until the next change to the buffer.
+ */
+unsigned char *
+dc_buffer_append_prepare (dc_buffer_t *buffer, size_t size);
+
+int
+dc_buffer_append_commit (dc_buffer_t *buffer, size_t size);
+
 int
 dc_buffer_prepend (dc_buffer_t *buffer, const unsigned char data[], size_t size);
 
@@ -57,6 +87,14 @@ dc_buffer_insert (dc_buffer_t *buffer, size_t offset, const unsigned char data[]
 int
 dc_buffer_slice (dc_buffer_t *buffer, size_t offset, size_t size);
 
+/*
+ * Get a view of a part of the buffer, for example to pass it to a parser,
+ * without copying it. The view remains valid until the buffer is changed
+ * or freed.
+ */
+int
+dc_buffer_view (dc_buffer_t *buffer, size_t offset, size_t size, dc_buffer_view_t *view);
+
 size_t
 dc_buffer_get_size (dc_buffer_t *buffer);
 
@@ -22,6 +22,8 @@
 #ifndef DC_CONTEXT_H
 #define DC_CONTEXT_H
 
+#include <stddef.h>
+
 #include "common.h"
 
 #ifdef __cplusplus
@@ -56,6 +58,30 @@ dc_context_set_logfunc (dc_context_t *context, dc_logfunc_t logfunc, void *userd
 unsigned int
 dc_context_get_transports (dc_context_t *context);
 
+/*
+ * Memory allocator
+ *
+ * The memory of the parsers, and of the buffers created with
+ * dc_buffer_new2(), is allocated through the allocator of their context.
+ * The functions have the semantics of the standard malloc, realloc and
+ * free functions. The default allocator uses those.
+ */
+typedef struct dc_allocator_t {
+	void *(*alloc) (size_t size, void *userdata);
+	void *(*resize) (void *ptr, size_t size, void *userdata);
+	void (*release) (void *ptr, void *userdata);
+	void *userdata;
+} dc_allocator_t;
+
+/*
+ * Replace the allocator of the context, or restore the default one if
+ * the allocator is NULL. The allocator is copied. Memory is released
+ * with the allocator it was allocated with, so the allocator can only
+ * be changed while no objects of the context are alive.
+ */
+dc_status_t
+dc_context_set_allocator (dc_context_t *context, const dc_allocator_t *allocator);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
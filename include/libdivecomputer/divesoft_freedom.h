@@ -0,0 +1,251 @@
+/*
+ * libdivecomputer
+ *
+ * Copyright (C) 2023 Jan Matoušek, Jef Driesen
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+#ifndef DC_DIVESOFT_FREEDOM_H
+#define DC_DIVESOFT_FREEDOM_H
+
+#include "common.h"
+#include "device.h"
+#include "parser.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/*
+ * The types of the records in a Divesoft dive profile.
+ */
+typedef enum divesoft_freedom_record_type_t {
+	DIVESOFT_FREEDOM_RECORD_POINT          = 0,
+	DIVESOFT_FREEDOM_RECORD_MANIPULATION   = 1,
+	DIVESOFT_FREEDOM_RECORD_AUTO           = 2,
+	DIVESOFT_FREEDOM_RECORD_DIVER_ERROR    = 3,
+	DIVESOFT_FREEDOM_RECORD_INTERNAL_ERROR = 4,
+	DIVESOFT_FREEDOM_RECORD_ACTIVITY       = 5,
+	DIVESOFT_FREEDOM_RECORD_CONFIGURATION  = 6,
+	DIVESOFT_FREEDOM_RECORD_MEASURE        = 7,
+	DIVESOFT_FREEDOM_RECORD_STATE          = 8,
+	DIVESOFT_FREEDOM_RECORD_INFO           = 9,
+} divesoft_freedom_record_type_t;
+
+/* Bitmask to select one record type. */
+#define DIVESOFT_FREEDOM_RECORD_MASK(type) (1u << (type))
+
+/* All record types. */
+#define DIVESOFT_FREEDOM_RECORD_ALL 0xFFFFu
+
+/* The end of a time window without an upper bound. */
+#define DIVESOFT_FREEDOM_TIME_END 0xFFFFFFFFu
+
+typedef struct divesoft_freedom_record_t {
+	unsigned int type;      /* Record type (divesoft_freedom_record_type_t) */
+	unsigned int id;        /* Record id, meaning depends on the type */
+	unsigned int timestamp; /* Seconds since the start of the dive */
+	unsigned int offset;    /* Offset of the record in the dive data */
+	const unsigned char *data; /* The raw record */
+	unsigned int size;
+} divesoft_freedom_record_t;
+
+/*
+ * Return non-zero to continue with the next record, or zero to stop.
+ */
+typedef int (*divesoft_freedom_record_callback_t) (const divesoft_freedom_record_t *record, void *userdata);
+
+/*
+ * Check the dive data for the errors that would make the parser fail,
+ * without decoding the samples: the signature, size and checksum of the
+ * header, the order of the record timestamps, and the gas mixes and
+ * tanks referred to by the records. Only the header, the first word of
+ * every record and the records other than the regular data points are
+ * read, so corrupt files can be rejected cheaply. The fields of the dive
+ * are cached along the way.
+ */
+dc_status_t
+divesoft_freedom_parser_validate (dc_parser_t *parser);
+
+/*
+ * The reasons for skipping a part of the dive profile in tolerant mode.
+ */
+typedef enum divesoft_freedom_skip_t {
+	DIVESOFT_FREEDOM_SKIP_TIMESTAMP = 1, /* Timestamp out of sequence */
+	DIVESOFT_FREEDOM_SKIP_TYPE      = 2, /* Unknown record type */
+	DIVESOFT_FREEDOM_SKIP_GASMIX    = 3, /* Too many gas mixes */
+	DIVESOFT_FREEDOM_SKIP_TANK      = 4, /* Too many tanks, or an unknown tank */
+	DIVESOFT_FREEDOM_SKIP_TRUNCATED = 5, /* Incomplete record at the end */
+} divesoft_freedom_skip_t;
+
+typedef struct divesoft_freedom_range_t {
+	unsigned int offset; /* Offset of the first skipped byte */
+	unsigned int size;   /* Number of skipped bytes */
+	unsigned int reason; /* Reason (divesoft_freedom_skip_t) */
+} divesoft_freedom_range_t;
+
+typedef struct divesoft_freedom_diagnostics_t {
+	unsigned int nrecords;  /* Number of records used */
+	unsigned int skipped;   /* Total number of skipped bytes */
+	unsigned int nranges;
+	const divesoft_freedom_range_t *ranges; /* In the order of the data */
+} divesoft_freedom_diagnostics_t;
+
+/*
+ * Enable (non-zero) or disable (zero) the tolerant mode. By default, a
+ * record that jumps back in time by more than a few seconds, or that
+ * refers to a gas mix or tank that is not available, is an error and the
+ * whole dive is rejected. In tolerant mode, such records are skipped
+ * instead, and the parser resynchronises on the next plausible record,
+ * even if that is not aligned with the damaged one. The skipped parts
+ * are reported by divesoft_freedom_parser_get_diagnostics.
+ *
+ * Changing the mode discards the cached data, and rewinds the samples.
+ */
+dc_status_t
+divesoft_freedom_parser_set_tolerant (dc_parser_t *parser, unsigned int tolerant);
+
+/*
+ * Get the parts of the dive profile that were skipped. The ranges are
+ * owned by the parser, and remain valid until the parser is destroyed or
+ * reset, or the mode is changed. An incomplete record at the end of the
+ * data is reported in both modes; the other reasons only in tolerant
+ * mode.
+ */
+dc_status_t
+divesoft_freedom_parser_get_diagnostics (dc_parser_t *parser, divesoft_freedom_diagnostics_t *diagnostics);
+
+/*
+ * Build the random access index of the dive profile: a sorted table of
+ * the record timestamps, and the list of records of every type. The
+ * index is built automatically on the first call to
+ * divesoft_freedom_parser_records_foreach, but it can be built upfront
+ * to keep that cost out of an interactive path.
+ */
+dc_status_t
+divesoft_freedom_parser_index (dc_parser_t *parser);
+
+/*
+ * Call the callback for every record of the selected types (a bitmask of
+ * DIVESOFT_FREEDOM_RECORD_MASK values) within the time window [begin,
+ * end), in the order in which they are stored. The start of the window
+ * is located with a binary search, so only the selected records are
+ * visited.
+ *
+ * Timestamps are in seconds, like in the records. Records that jump back
+ * in time (which the sample parser skips) are treated as having the
+ * timestamp of the preceding record.
+ */
+dc_status_t
+divesoft_freedom_parser_records_foreach (dc_parser_t *parser, unsigned int types, unsigned int begin, unsigned int end, divesoft_freedom_record_callback_t callback, void *userdata);
+
+/* The number of tissue compartments of the decompression model. */
+#define DIVESOFT_FREEDOM_NCOMPARTMENTS 16
+
+/* The inert gases with a reported tissue state. */
+#define DIVESOFT_FREEDOM_TISSUE_N2 0x01
+#define DIVESOFT_FREEDOM_TISSUE_HE 0x02
+
+/*
+ * The tissue state of the decompression model at one point in time.
+ *
+ * The loadings are the raw 11 bit values of the dive computer, for the
+ * compartments from the fastest to the slowest. The extra bit stored with
+ * every value is reported in the flags (bit i for compartment i); it
+ * appears to mark the compartments that are off-gassing. Compartments
+ * that are not updated at a timestamp keep their previous value.
+ */
+typedef struct divesoft_freedom_tissue_t {
+	unsigned int time;      /* Seconds since the start of the dive */
+	unsigned int valid;     /* DIVESOFT_FREEDOM_TISSUE_* reported so far */
+	unsigned int n2[DIVESOFT_FREEDOM_NCOMPARTMENTS];
+	unsigned int n2_flags;
+	unsigned int he[DIVESOFT_FREEDOM_NCOMPARTMENTS];
+	unsigned int he_flags;
+} divesoft_freedom_tissue_t;
+
+/*
+ * Get the tissue timeline, decoded from the tissue saturation records:
+ * one entry for every timestamp with a tissue state, in chronological
+ * order. The array is owned by the parser, and remains valid until the
+ * parser is destroyed or reset. The planned ascent steps are not
+ * decoded; they are available as raw records through
+ * divesoft_freedom_parser_records_foreach.
+ */
+dc_status_t
+divesoft_freedom_parser_get_tissues (dc_parser_t *parser, const divesoft_freedom_tissue_t **tissues, unsigned int *count);
+
+/*
+ * Callback for the dive data, called with every piece that is received
+ * while downloading a dive. The offset of the piece within the dive is
+ * zero at the start of every dive. The complete dive is passed to the
+ * dive callback afterwards, as usual.
+ */
+typedef void (*divesoft_freedom_data_callback_t) (const unsigned char data[], unsigned int size, unsigned int offset, void *userdata);
+
+dc_status_t
+divesoft_freedom_device_set_data_callback (dc_device_t *device, divesoft_freedom_data_callback_t callback, void *userdata);
+
+/*
+ * Incremental parsing of a dive profile, while it is still arriving, for
+ * example from the data callback above.
+ *
+ * The dive data is fed to the stream in pieces of any size, and the
+ * samples of the complete records are drained as soon as they are
+ * available. Only the header and the records that are not drained yet
+ * are kept in memory. The samples are the same as those of the regular
+ * parser, except that the decoding only starts after the configuration
+ * records at the start of the profile, and that gas mixes only used in
+ * later gas changes are numbered in the order in which they appear.
+ */
+typedef struct divesoft_freedom_stream_t divesoft_freedom_stream_t;
+
+/*
+ * Create a stream, for the selected sample types (a bitmask of
+ * DC_SAMPLE_MASK values, or DC_SAMPLE_MASK_ALL).
+ */
+dc_status_t
+divesoft_freedom_stream_new (divesoft_freedom_stream_t **stream, dc_context_t *context, unsigned int types);
+
+/*
+ * Append the next piece of the dive data.
+ */
+dc_status_t
+divesoft_freedom_stream_feed (divesoft_freedom_stream_t *stream, const unsigned char data[], size_t size);
+
+/*
+ * Mark the end of the dive data. This also allows a dive with only
+ * configuration records to be decoded.
+ */
+dc_status_t
+divesoft_freedom_stream_finish (divesoft_freedom_stream_t *stream);
+
+/*
+ * Read up to count samples from the records received so far. Fewer
+ * samples than requested (possibly none) means all the data fed so far
+ * has been decoded. Errors are sticky.
+ */
+dc_status_t
+divesoft_freedom_stream_drain (divesoft_freedom_stream_t *stream, dc_sample_t samples[], unsigned int count, unsigned int *actual);
+
+dc_status_t
+divesoft_freedom_stream_free (divesoft_freedom_stream_t *stream);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+#endif /* DC_DIVESOFT_FREEDOM_H */
@@ -288,12 +288,28 @@ typedef struct dc_parser_t dc_parser_t;
 
 typedef void (*dc_sample_callback_t) (dc_sample_type_t type, const dc_sample_value_t *value, void *userdata);
 
+typedef struct dc_sample_t {
+	dc_sample_type_t type;
+	dc_sample_value_t value;
+} dc_sample_t;
+
 dc_status_t
 dc_parser_new (dc_parser_t **parser, dc_device_t *device, const unsigned char data[], size_t size);
 
 dc_status_t
 dc_parser_new2 (dc_parser_t **parser, dc_context_t *context, dc_descriptor_t *descriptor, const unsigned char data[], size_t size);
 
+/*
+ * Borrowed data
+ *
+ * Same as dc_parser_new2(), except that the parser does not make a
+ * private copy of the data. The caller must keep the data valid and
+ * unmodified until the parser is destroyed. This avoids a second copy
+ * of large (e.g. memory mapped) dive logs.
+ */
+dc_status_t
+dc_parser_new2_borrowed (dc_parser_t **parser, dc_context_t *context, dc_descriptor_t *descriptor, const unsigned char data[], size_t size);
+
 dc_family_t
 dc_parser_get_type (dc_parser_t *parser);
 
@@ -312,9 +328,106 @@ dc_parser_get_datetime (dc_parser_t *parser, dc_datetime_t *datetime);
 dc_status_t
 dc_parser_get_field (dc_parser_t *parser, dc_field_type_t type, unsigned int flags, void *value);
 
+/*
+ * Dive summary
+ *
+ * All the fields of a dive in a single call. The bitmask tells which
+ * fields are available (see DC_FIELD_MASK); only those are valid. The
+ * gas mix and tank counts are the total numbers, but only the first
+ * DC_SUMMARY_MAXGASMIXES gas mixes and DC_SUMMARY_MAXTANKS tanks are
+ * stored. Any further ones can be retrieved with dc_parser_get_field().
+ *
+ * The values are the same as those of dc_parser_get_field(). A field
+ * that fails is left out. DC_STATUS_UNSUPPORTED is not an error, but
+ * for any other error the remaining fields are still filled in, and
+ * the first error is returned.
+ */
+#define DC_FIELD_MASK(type) (1u << (type))
+
+#define DC_SUMMARY_MAXGASMIXES 20
+#define DC_SUMMARY_MAXTANKS    20
+
+typedef struct dc_summary_t {
+	unsigned int fields; /* Available fields (DC_FIELD_MASK values) */
+	unsigned int divetime;
+	double maxdepth;
+	double avgdepth;
+	double temperature_surface;
+	double temperature_minimum;
+	double temperature_maximum;
+	dc_salinity_t salinity;
+	double atmospheric;
+	dc_divemode_t divemode;
+	dc_decomodel_t decomodel;
+	dc_location_t location;
+	unsigned int ngasmixes;
+	dc_gasmix_t gasmix[DC_SUMMARY_MAXGASMIXES];
+	unsigned int ntanks;
+	dc_tank_t tank[DC_SUMMARY_MAXTANKS];
+} dc_summary_t;
+
+dc_status_t
+dc_parser_get_summary (dc_parser_t *parser, dc_summary_t *summary);
+
 dc_status_t
 dc_parser_samples_foreach (dc_parser_t *parser, dc_sample_callback_t callback, void *userdata);
 
+/*
+ * Filtered samples
+ *
+ * Same as dc_parser_samples_foreach(), except that only the sample types
+ * in the bitmask (see DC_SAMPLE_MASK) are reported, and only for the
+ * samples with a time (in milliseconds) within the window [begin, end).
+ * The result is identical to filtering the output of
+ * dc_parser_samples_foreach(), but backends can use the filter to skip
+ * the decoding of unwanted data, and to seek to the start of the window.
+ * As a consequence, errors in the parts of the data that are skipped may
+ * not be reported.
+ */
+#define DC_SAMPLE_MASK(type) (1u << (type))
+#define DC_SAMPLE_MASK_ALL   0xFFFFFFFFu
+#define DC_SAMPLE_TIME_END   0xFFFFFFFFu
+
+dc_status_t
+dc_parser_samples_foreach_filtered (dc_parser_t *parser, unsigned int types, unsigned int begin, unsigned int end, dc_sample_callback_t callback, void *userdata);
+
+/*
+ * Batched samples
+ *
+ * Store the next samples into the array, up to the given count, and
+ * return the number of samples stored. The samples are the same, and in
+ * the same order, as those passed to the callback of
+ * dc_parser_samples_foreach(), but without a function call per value.
+ * Every call continues where the previous one stopped, until no more
+ * samples are returned at the end of the dive. Use
+ * dc_parser_samples_rewind() to start again from the beginning.
+ *
+ * On error, the number of samples stored before the error is returned
+ * as well.
+ */
+dc_status_t
+dc_parser_samples_read (dc_parser_t *parser, dc_sample_t samples[], unsigned int count, unsigned int *actual);
+
+dc_status_t
+dc_parser_samples_rewind (dc_parser_t *parser);
+
+/*
+ * Reuse the parser for another dive of the same device
+ *
+ * Bind the parser to new data, and discard everything that was cached
+ * from the previous dive. A parser created with dc_parser_new2() copies
+ * the data into its existing buffer, which only grows when the data no
+ * longer fits. A parser created with dc_parser_new2_borrowed() borrows
+ * the new data as well. The clock, atmospheric pressure, density and
+ * sample filter settings are kept, and the samples are rewound.
+ *
+ * Returns DC_STATUS_UNSUPPORTED if the backend does not support this;
+ * create a new parser instead. On error, the parser remains bound to
+ * the previous data.
+ */
+dc_status_t
+dc_parser_reset (dc_parser_t *parser, const unsigned char data[], size_t size);
+
 dc_status_t
 dc_parser_destroy (dc_parser_t *parser);
 
@@ -0,0 +1,252 @@
+/*
+ * libdivecomputer
+ *
+ * Copyright (C) 2023 Jules
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+#include <stdlib.h> // malloc, free
+#include <string.h> // memcpy
+
+#include <libdivecomputer/arena.h>
+
+// Alignment of every allocation, enough for any basic type.
+#define ALIGNMENT 16
+#define ALIGN(x) (((x) + (ALIGNMENT - 1)) & ~(size_t) (ALIGNMENT - 1))
+
+// Every allocation is preceded by its size, to support resizing.
+#define HEADER ALIGN(sizeof (size_t))
+
+#define DEFAULT_BLOCKSIZE (64 * 1024)
+
+typedef struct dc_arena_block_t {
+	struct dc_arena_block_t *next;
+	size_t size;
+	size_t used;
+} dc_arena_block_t;
+
+#define BLOCKHEADER ALIGN(sizeof (dc_arena_block_t))
+
+struct dc_arena_t {
+	// The current block, followed by the previous (full) ones.
+	dc_arena_block_t *block;
+	// The most recent allocation, which can be resized in place.
+	unsigned char *last;
+	size_t blocksize;
+};
+
+static unsigned char *
+dc_arena_block_data (dc_arena_block_t *block)
+{
+	return (unsigned char *) block + BLOCKHEADER;
+}
+
+static size_t
+dc_arena_size (const unsigned char *ptr)
+{
+	size_t size = 0;
+	memcpy (&size, ptr - HEADER, sizeof (size));
+	return size;
+}
+
+static void
+dc_arena_set_size (unsigned char *ptr, size_t size)
+{
+	memcpy (ptr - HEADER, &size, sizeof (size));
+}
+
+static dc_arena_block_t *
+dc_arena_block_new (size_t size)
+{
+	if (size > (size_t) -1 - BLOCKHEADER)
+		return NULL;
+
+	dc_arena_block_t *block = (dc_arena_block_t *) malloc (BLOCKHEADER + size);
+	if (block == NULL)
+		return NULL;
+
+	block->next = NULL;
+	block->size = size;
+	block->used = 0;
+
+	return block;
+}
+
+static void *
+dc_arena_alloc (size_t size, void *userdata)
+{
+	dc_arena_t *arena = (dc_arena_t *) userdata;
+
+	if (size > (size_t) -1 - HEADER - ALIGNMENT)
+		return NULL;
+
+	size_t needed = HEADER + ALIGN(size);
+
+	dc_arena_block_t *block = arena->block;
+	if (block == NULL || block->size - block->used < needed) {
+		block = dc_arena_block_new (needed > arena->blocksize ? needed : arena->blocksize);
+		if (block == NULL)
+			return NULL;
+
+		block->next = arena->block;
+		arena->block = block;
+	}
+
+	unsigned char *ptr = dc_arena_block_data (block) + block->used + HEADER;
+	dc_arena_set_size (ptr, size);
+	block->used += needed;
+
+	arena->last = ptr;
+
+	return ptr;
+}
+
+static void *
+dc_arena_resize (void *ptr, size_t size, void *userdata)
+{
+	dc_arena_t *arena = (dc_arena_t *) userdata;
+	unsigned char *p = (unsigned char *) ptr;
+
+	if (p == NULL)
+		return dc_arena_alloc (size, userdata);
+
+	size_t oldsize = dc_arena_size (p);
+
+	// The most recent allocation grows or shrinks in place, if the
+	// block has enough room left.
+	if (p == arena->last && size <= (size_t) -1 - HEADER - ALIGNMENT) {
+		dc_arena_block_t *block = arena->block;
+		size_t offset = p - dc_arena_block_data (block);
+		if (block->size - offset >= ALIGN(size)) {
+			block->used = offset + ALIGN(size);
+			dc_arena_set_size (p, size);
+			return p;
+		}
+	}
+
+	if (size <= oldsize) {
+		dc_arena_set_size (p, size);
+		return p;
+	}
+
+	unsigned char *newptr = (unsigned char *) dc_arena_alloc (size, userdata);
+	if (newptr == NULL)
+		return NULL;
+
+	memcpy (newptr, p, oldsize);
+
+	return newptr;
+}
+
+static void
+dc_arena_release (void *ptr, void *userdata)
+{
+	dc_arena_t *arena = (dc_arena_t *) userdata;
+	unsigned char *p = (unsigned char *) ptr;
+
+	// Only the most recent allocation is given back.
+	if (p != NULL && p == arena->last) {
+		dc_arena_block_t *block = arena->block;
+		block->used = p - HEADER - dc_arena_block_data (block);
+		arena->last = NULL;
+	}
+}
+
+dc_status_t
+dc_arena_new (dc_arena_t **out, size_t blocksize)
+{
+	dc_arena_t *arena = NULL;
+
+	if (out == NULL)
+		return DC_STATUS_INVALIDARGS;
+
+	arena = (dc_arena_t *) malloc (sizeof (dc_arena_t));
+	if (arena == NULL)
+		return DC_STATUS_NOMEMORY;
+
+	arena->block = NULL;
+	arena->last = NULL;
+	arena->blocksize = blocksize ? ALIGN(blocksize) : DEFAULT_BLOCKSIZE;
+
+	*out = arena;
+
+	return DC_STATUS_SUCCESS;
+}
+
+dc_status_t
+dc_arena_reset (dc_arena_t *arena)
+{
+	if (arena == NULL)
+		return DC_STATUS_INVALIDARGS;
+
+	arena->last = NULL;
+
+	dc_arena_block_t *block = arena->block;
+	if (block == NULL)
+		return DC_STATUS_SUCCESS;
+
+	if (block->next == NULL) {
+		block->used = 0;
+		return DC_STATUS_SUCCESS;
+	}
+
+	// Replace all the blocks with a single one of the same total size,
+	// so the next round fits in one block.
+	size_t total = 0;
+	while (block) {
+		dc_arena_block_t *next = block->next;
+		total += block->size;
+		free (block);
+		block = next;
+	}
+
+	arena->block = dc_arena_block_new (total);
+
+	return DC_STATUS_SUCCESS;
+}
+
+dc_status_t
+dc_arena_free (dc_arena_t *arena)
+{
+	if (arena == NULL)
+		return DC_STATUS_SUCCESS;
+
+	dc_arena_block_t *block = arena->block;
+	while (block) {
+		dc_arena_block_t *next = block->next;
+		free (block);
+		block = next;
+	}
+
+	free (arena);
+
+	return DC_STATUS_SUCCESS;
+}
+
+dc_status_t
+dc_arena_get_allocator (dc_arena_t *arena, dc_allocator_t *allocator)
+{
+	if (arena == NULL || allocator == NULL)
+		return DC_STATUS_INVALIDARGS;
+
+	allocator->alloc = dc_arena_alloc;
+	allocator->resize = dc_arena_resize;
+	allocator->release = dc_arena_release;
+	allocator->userdata = arena;
+
+	return DC_STATUS_SUCCESS;
+}
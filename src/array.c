@@ -21,6 +21,14 @@
 
 #include <string.h>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define HAVE_SSE2
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define HAVE_NEON
+#endif
+
 #include "array.h"
 
 void
@@ -60,15 +68,101 @@ array_reverse_nibbles (unsigned char data[], unsigned int size)
 	}
 }
 
+unsigned int
+array_span (const unsigned char data[], unsigned int size, unsigned char value)
+{
+	unsigned int i = 0;
+
+#if defined(HAVE_SSE2)
+	const __m128i pattern = _mm_set1_epi8 ((char) value);
+	for (; i + 64 <= size; i += 64) {
+		__m128i a = _mm_cmpeq_epi8 (_mm_loadu_si128 ((const __m128i *) (data + i)), pattern);
+		__m128i b = _mm_cmpeq_epi8 (_mm_loadu_si128 ((const __m128i *) (data + i + 16)), pattern);
+		__m128i c = _mm_cmpeq_epi8 (_mm_loadu_si128 ((const __m128i *) (data + i + 32)), pattern);
+		__m128i d = _mm_cmpeq_epi8 (_mm_loadu_si128 ((const __m128i *) (data + i + 48)), pattern);
+		if (_mm_movemask_epi8 (_mm_and_si128 (_mm_and_si128 (a, b), _mm_and_si128 (c, d))) != 0xFFFF)
+			break;
+	}
+	for (; i + 16 <= size; i += 16) {
+		__m128i a = _mm_cmpeq_epi8 (_mm_loadu_si128 ((const __m128i *) (data + i)), pattern);
+		if (_mm_movemask_epi8 (a) != 0xFFFF)
+			break;
+	}
+#elif defined(HAVE_NEON)
+	const uint8x16_t pattern = vdupq_n_u8 (value);
+	for (; i + 16 <= size; i += 16) {
+		if (vminvq_u8 (vceqq_u8 (vld1q_u8 (data + i), pattern)) != 0xFF)
+			break;
+	}
+#else
+	const size_t pattern = (size_t) -1 / 0xFF * value;
+	for (; i + sizeof (size_t) <= size; i += sizeof (size_t)) {
+		size_t word;
+		memcpy (&word, data + i, sizeof (word));
+		if (word != pattern)
+			break;
+	}
+#endif
+
+	// Locate the mismatch within the last block.
+	while (i < size && data[i] == value)
+		i++;
+
+	return i;
+}
+
+
 int
 array_isequal (const unsigned char data[], unsigned int size, unsigned char value)
 {
-	for (unsigned int i = 0; i < size; ++i) {
-		if (data[i] != value)
-			return 0;
+	return array_span (data, size, value) == size;
+}
+
+
+/*
+ * The searches scan for a single byte of the marker, and only compare
+ * the whole marker where that byte is found. That byte is preferably not
+ * 0x00 or 0xFF, the padding of unused memory, which is the bulk of most
+ * memory dumps.
+ */
+static unsigned int
+array_search_anchor (const unsigned char marker[], unsigned int msize)
+{
+	for (unsigned int i = msize; i > 0; --i) {
+		if (marker[i - 1] != 0x00 && marker[i - 1] != 0xFF)
+			return i - 1;
+	}
+
+	return msize - 1;
+}
+
+
+static const unsigned char *
+array_memrchr (const unsigned char data[], unsigned int size, unsigned char value)
+{
+#if defined(HAVE_SSE2)
+	const __m128i pattern = _mm_set1_epi8 ((char) value);
+	for (; size >= 16; size -= 16) {
+		__m128i a = _mm_cmpeq_epi8 (_mm_loadu_si128 ((const __m128i *) (data + size - 16)), pattern);
+		if (_mm_movemask_epi8 (a) != 0)
+			break;
+	}
+#elif defined(HAVE_NEON)
+	const uint8x16_t pattern = vdupq_n_u8 (value);
+	for (; size >= 16; size -= 16) {
+		if (vmaxvq_u8 (vceqq_u8 (vld1q_u8 (data + size - 16), pattern)) != 0)
+			break;
 	}
+#endif
 
-	return 1;
+	// Locate the match within the last block.
+	while (size > 0) {
+		size--;
+		if (data[size] == value)
+			return data + size;
+	}
+
+	return NULL;
 }
 
 
@@ -76,27 +170,56 @@ const unsigned char *
 array_search_forward (const unsigned char *data, unsigned int size,
                       const unsigned char *marker, unsigned int msize)
 {
-	while (size >= msize) {
-		if (memcmp (data, marker, msize) == 0)
-			return data;
-		size--;
-		data++;
+	if (msize == 0)
+		return data;
+
+	if (size < msize)
+		return NULL;
+
+	// Candidate positions of the anchor byte.
+	unsigned int anchor = array_search_anchor (marker, msize);
+	const unsigned char *p = data + anchor;
+	const unsigned char *end = data + size - (msize - 1 - anchor);
+	while (p < end) {
+		p = memchr (p, marker[anchor], end - p);
+		if (p == NULL)
+			break;
+		if (memcmp (p - anchor, marker, msize) == 0)
+			return p - anchor;
+		p++;
 	}
+
 	return NULL;
 }
 
 
+/*
+ * Unlike the forward search, the result points past the end of the
+ * marker.
+ */
 const unsigned char *
 array_search_backward (const unsigned char *data, unsigned int size,
                        const unsigned char *marker, unsigned int msize)
 {
-	data += size;
-	while (size >= msize) {
-		if (memcmp (data - msize, marker, msize) == 0)
-			return data;
-		size--;
-		data--;
+	if (msize == 0)
+		return data + size;
+
+	if (size < msize)
+		return NULL;
+
+	// Candidate positions of the anchor byte.
+	unsigned int anchor = array_search_anchor (marker, msize);
+	const unsigned char *begin = data + anchor;
+	unsigned int n = size - msize + 1;
+	while (n > 0) {
+		const unsigned char *p = array_memrchr (begin, n, marker[anchor]);
+		if (p == NULL)
+			break;
+		if (memcmp (p - anchor, marker, msize) == 0)
+			return p - anchor + msize;
+		n = p - begin;
 	}
+
 	return NULL;
 }
 
@@ -216,92 +339,6 @@ array_uint_le (const unsigned char data[], unsigned int n)
 	return value;
 }
 
-unsigned long long
-array_uint64_be (const unsigned char data[])
-{
-	return ((unsigned long long) data[0] << 56) |
-	       ((unsigned long long) data[1] << 48) |
-	       ((unsigned long long) data[2] << 40) |
-	       ((unsigned long long) data[3] << 32) |
-	       ((unsigned long long) data[4] << 24) |
-	       ((unsigned long long) data[5] << 16) |
-	       ((unsigned long long) data[6] <<  8) |
-	       ((unsigned long long) data[7] <<  0);
-}
-
-unsigned long long
-array_uint64_le (const unsigned char data[])
-{
-	return ((unsigned long long) data[0] <<  0) |
-	       ((unsigned long long) data[1] <<  8) |
-	       ((unsigned long long) data[2] << 16) |
-	       ((unsigned long long) data[3] << 24) |
-	       ((unsigned long long) data[4] << 32) |
-	       ((unsigned long long) data[5] << 40) |
-	       ((unsigned long long) data[6] << 48) |
-	       ((unsigned long long) data[7] << 56);
-}
-
-unsigned int
-array_uint32_be (const unsigned char data[])
-{
-	return ((unsigned int) data[0] << 24) |
-	       ((unsigned int) data[1] << 16) |
-	       ((unsigned int) data[2] <<  8) |
-	       ((unsigned int) data[3] <<  0);
-}
-
-
-unsigned int
-array_uint32_le (const unsigned char data[])
-{
-	return ((unsigned int) data[0] <<  0) |
-	       ((unsigned int) data[1] <<  8) |
-	       ((unsigned int) data[2] << 16) |
-	       ((unsigned int) data[3] << 24);
-}
-
-
-unsigned int
-array_uint32_word_be (const unsigned char data[])
-{
-	return ((unsigned int) data[0] <<  8) |
-	       ((unsigned int) data[1] <<  0) |
-	       ((unsigned int) data[2] << 24) |
-	       ((unsigned int) data[3] << 16);
-}
-
-unsigned int
-array_uint24_be (const unsigned char data[])
-{
-	return ((unsigned int) data[0] << 16) |
-	       ((unsigned int) data[1] <<  8) |
-	       ((unsigned int) data[2] <<  0);
-}
-
-unsigned int
-array_uint24_le (const unsigned char data[])
-{
-	return ((unsigned int) data[0] <<  0) |
-	       ((unsigned int) data[1] <<  8) |
-	       ((unsigned int) data[2] << 16);
-}
-
-unsigned short
-array_uint16_be (const unsigned char data[])
-{
-	return ((unsigned int) data[0] <<  8) |
-	       ((unsigned int) data[1] <<  0);
-}
-
-
-unsigned short
-array_uint16_le (const unsigned char data[])
-{
-	return ((unsigned int) data[0] <<  0) |
-	       ((unsigned int) data[1] <<  8);
-}
-
 float
 array_float_le (const unsigned char data[])
 {
@@ -38,6 +38,13 @@ array_reverse_bits (unsigned char data[], unsigned int size);
 void
 array_reverse_nibbles (unsigned char data[], unsigned int size);
 
+/*
+ * The number of leading bytes equal to the value, which is the offset of
+ * the first byte that differs, or the size if there is none.
+ */
+unsigned int
+array_span (const unsigned char data[], unsigned int size, unsigned char value);
+
 int
 array_isequal (const unsigned char data[], unsigned int size, unsigned char value);
 
@@ -70,33 +77,6 @@ array_uint_be (const unsigned char data[], unsigned int n);
 unsigned int
 array_uint_le (const unsigned char data[], unsigned int n);
 
-unsigned long long
-array_uint64_be (const unsigned char data[]);
-
-unsigned long long
-array_uint64_le (const unsigned char data[]);
-
-unsigned int
-array_uint32_be (const unsigned char data[]);
-
-unsigned int
-array_uint32_le (const unsigned char data[]);
-
-unsigned int
-array_uint32_word_be (const unsigned char data[]);
-
-unsigned int
-array_uint24_be (const unsigned char data[]);
-
-unsigned int
-array_uint24_le (const unsigned char data[]);
-
-unsigned short
-array_uint16_be (const unsigned char data[]);
-
-unsigned short
-array_uint16_le (const unsigned char data[]);
-
 float
 array_float_le (const unsigned char data[]);
 
@@ -136,6 +116,93 @@ signextend (unsigned int value, unsigned int nbits);
 unsigned int
 popcount (unsigned int value);
 
+/*
+ * The fixed size integer readers are defined inline, because the parsers
+ * call them for every field of every record.
+ */
+static inline unsigned long long
+array_uint64_be (const unsigned char data[])
+{
+	return ((unsigned long long) data[0] << 56) |
+	       ((unsigned long long) data[1] << 48) |
+	       ((unsigned long long) data[2] << 40) |
+	       ((unsigned long long) data[3] << 32) |
+	       ((unsigned long long) data[4] << 24) |
+	       ((unsigned long long) data[5] << 16) |
+	       ((unsigned long long) data[6] <<  8) |
+	       ((unsigned long long) data[7] <<  0);
+}
+
+static inline unsigned long long
+array_uint64_le (const unsigned char data[])
+{
+	return ((unsigned long long) data[0] <<  0) |
+	       ((unsigned long long) data[1] <<  8) |
+	       ((unsigned long long) data[2] << 16) |
+	       ((unsigned long long) data[3] << 24) |
+	       ((unsigned long long) data[4] << 32) |
+	       ((unsigned long long) data[5] << 40) |
+	       ((unsigned long long) data[6] << 48) |
+	       ((unsigned long long) data[7] << 56);
+}
+
+static inline unsigned int
+array_uint32_be (const unsigned char data[])
+{
+	return ((unsigned int) data[0] << 24) |
+	       ((unsigned int) data[1] << 16) |
+	       ((unsigned int) data[2] <<  8) |
+	       ((unsigned int) data[3] <<  0);
+}
+
+static inline unsigned int
+array_uint32_le (const unsigned char data[])
+{
+	return ((unsigned int) data[0] <<  0) |
+	       ((unsigned int) data[1] <<  8) |
+	       ((unsigned int) data[2] << 16) |
+	       ((unsigned int) data[3] << 24);
+}
+
+static inline unsigned int
+array_uint32_word_be (const unsigned char data[])
+{
+	return ((unsigned int) data[0] <<  8) |
+	       ((unsigned int) data[1] <<  0) |
+	       ((unsigned int) data[2] << 24) |
+	       ((unsigned int) data[3] << 16);
+}
+
+static inline unsigned int
+array_uint24_be (const unsigned char data[])
+{
+	return ((unsigned int) data[0] << 16) |
+	       ((unsigned int) data[1] <<  8) |
+	       ((unsigned int) data[2] <<  0);
+}
+
+static inline unsigned int
+array_uint24_le (const unsigned char data[])
+{
+	return ((unsigned int) data[0] <<  0) |
+	       ((unsigned int) data[1] <<  8) |
+	       ((unsigned int) data[2] << 16);
+}
+
+static inline unsigned short
+array_uint16_be (const unsigned char data[])
+{
+	return ((unsigned int) data[0] <<  8) |
+	       ((unsigned int) data[1] <<  0);
+}
+
+static inline unsigned short
+array_uint16_le (const unsigned char data[])
+{
+	return ((unsigned int) data[0] <<  0) |
+	       ((unsigned int) data[1] <<  8);
+}
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
@@ -57,7 +57,10 @@ static const dc_parser_vtable_t atomics_cobalt_parser_vtable = {
 	atomics_cobalt_parser_get_datetime, /* datetime */
 	atomics_cobalt_parser_get_field, /* fields */
 	atomics_cobalt_parser_samples_foreach, /* samples_foreach */
-	NULL /* destroy */
+	NULL, /* destroy */
+	NULL, /* samples_read */
+	NULL, /* reset */
+	NULL /* summary */
 };
 
 
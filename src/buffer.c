@@ -19,12 +19,15 @@
  * MA 02110-1301 USA
  */
 
-#include <stdlib.h> // malloc, realloc, free
+#include <stdint.h> // SIZE_MAX
 #include <string.h> // memcpy, memmove
 
 #include <libdivecomputer/buffer.h>
 
+#include "context-private.h"
+
 struct dc_buffer_t {
+	dc_context_t *context;
 	unsigned char *data;
 	size_t capacity, offset, size;
 };
@@ -32,20 +35,27 @@ struct dc_buffer_t {
 dc_buffer_t *
 dc_buffer_new (size_t capacity)
 {
-	dc_buffer_t *buffer = (dc_buffer_t *) malloc (sizeof (dc_buffer_t));
+	return dc_buffer_new2 (NULL, capacity);
+}
+
+dc_buffer_t *
+dc_buffer_new2 (dc_context_t *context, size_t capacity)
+{
+	dc_buffer_t *buffer = (dc_buffer_t *) dc_context_alloc (context, sizeof (dc_buffer_t));
 	if (buffer == NULL)
 		return NULL;
 
 	if (capacity) {
-		buffer->data = (unsigned char *) malloc (capacity);
+		buffer->data = (unsigned char *) dc_context_alloc (context, capacity);
 		if (buffer->data == NULL) {
-			free (buffer);
+			dc_context_release (context, buffer);
 			return NULL;
 		}
 	} else {
 		buffer->data = NULL;
 	}
 
+	buffer->context = context;
 	buffer->capacity = capacity;
 	buffer->offset = 0;
 	buffer->size = 0;
@@ -61,9 +71,9 @@ dc_buffer_free (dc_buffer_t *buffer)
 		return;
 
 	if (buffer->data)
-		free (buffer->data);
+		dc_context_release (buffer->context, buffer->data);
 
-	free (buffer);
+	dc_context_release (buffer->context, buffer);
 }
 
 
@@ -80,13 +90,20 @@ dc_buffer_clear (dc_buffer_t *buffer)
 }
 
 
+/*
+ * The capacity grows geometrically, so a series of small appends (or
+ * prepends) costs amortised O(1) per byte.
+ */
 static size_t
 dc_buffer_expand_calc (dc_buffer_t *buffer, size_t n)
 {
 	size_t oldsize = buffer->capacity;
 	size_t newsize = (oldsize ? oldsize : n);
-	while (newsize < n)
+	while (newsize < n) {
+		if (newsize > SIZE_MAX / 2)
+			return n;
 		newsize *= 2;
+	}
 
 	return newsize;
 }
@@ -96,17 +113,26 @@ static int
 dc_buffer_expand_append (dc_buffer_t *buffer, size_t n)
 {
 	if (n > buffer->capacity - buffer->offset) {
-		if (n > buffer->capacity) {
-			size_t capacity = dc_buffer_expand_calc (buffer, n);
-
-			unsigned char *data = (unsigned char *) malloc (capacity);
-			if (data == NULL)
-				return 0;
-
-			if (buffer->size)
-				memcpy (data, buffer->data + buffer->offset, buffer->size);
-
-			free (buffer->data);
+		// Moving the data to the front is only worth it if that frees at
+		// least as much space as it moves. Otherwise the buffer grows.
+		if (n > buffer->capacity || buffer->offset < buffer->size) {
+			size_t capacity = dc_buffer_expand_calc (buffer, n > buffer->capacity ? n : buffer->capacity + 1);
+
+			unsigned char *data = NULL;
+			if (buffer->offset == 0) {
+				data = (unsigned char *) dc_context_realloc (buffer->context, buffer->data, capacity);
+				if (data == NULL)
+					return 0;
+			} else {
+				data = (unsigned char *) dc_context_alloc (buffer->context, capacity);
+				if (data == NULL)
+					return 0;
+
+				if (buffer->size)
+					memcpy (data, buffer->data + buffer->offset, buffer->size);
+
+				dc_context_release (buffer->context, buffer->data);
+			}
 
 			buffer->data = data;
 			buffer->capacity = capacity;
@@ -129,17 +155,18 @@ dc_buffer_expand_prepend (dc_buffer_t *buffer, size_t n)
 	size_t available = buffer->capacity - buffer->size;
 
 	if (n > buffer->offset + buffer->size) {
-		if (n > buffer->capacity) {
-			size_t capacity = dc_buffer_expand_calc (buffer, n);
+		// Same as for appending, with the free space at the end.
+		if (n > buffer->capacity || available - buffer->offset < buffer->size) {
+			size_t capacity = dc_buffer_expand_calc (buffer, n > buffer->capacity ? n : buffer->capacity + 1);
 
-			unsigned char *data = (unsigned char *) malloc (capacity);
+			unsigned char *data = (unsigned char *) dc_context_alloc (buffer->context, capacity);
 			if (data == NULL)
 				return 0;
 
 			if (buffer->size)
 				memcpy (data + capacity - buffer->size, buffer->data + buffer->offset, buffer->size);
 
-			free (buffer->data);
+			dc_context_release (buffer->context, buffer->data);
 
 			buffer->data = data;
 			buffer->capacity = capacity;
@@ -165,7 +192,7 @@ dc_buffer_reserve (dc_buffer_t *buffer, size_t capacity)
 	if (capacity <= buffer->capacity)
 		return 1;
 
-	unsigned char *data = (unsigned char *) realloc (buffer->data, capacity);
+	unsigned char *data = (unsigned char *) dc_context_realloc (buffer->context, buffer->data, capacity);
 	if (data == NULL)
 		return 0;
 
@@ -194,6 +221,34 @@ dc_buffer_resize (dc_buffer_t *buffer, size_t size)
 }
 
 
+unsigned char *
+dc_buffer_append_prepare (dc_buffer_t *buffer, size_t size)
+{
+	if (buffer == NULL || size > SIZE_MAX - buffer->size)
+		return NULL;
+
+	if (!dc_buffer_expand_append (buffer, buffer->size + size))
+		return NULL;
+
+	return buffer->data + buffer->offset + buffer->size;
+}
+
+
+int
+dc_buffer_append_commit (dc_buffer_t *buffer, size_t size)
+{
+	if (buffer == NULL)
+		return 0;
+
+	if (size > buffer->capacity - buffer->offset - buffer->size)
+		return 0;
+
+	buffer->size += size;
+
+	return 1;
+}
+
+
 int
 dc_buffer_append (dc_buffer_t *buffer, const unsigned char data[], size_t size)
 {
@@ -273,7 +328,7 @@ dc_buffer_insert (dc_buffer_t *buffer, size_t offset, const unsigned char data[]
 
 		size_t tmp_offset = head > tail ? available : 0;
 
-		unsigned char *tmp = (unsigned char *) malloc (capacity);
+		unsigned char *tmp = (unsigned char *) dc_context_alloc (buffer->context, capacity);
 		if (tmp == NULL)
 			return 0;
 
@@ -282,7 +337,7 @@ dc_buffer_insert (dc_buffer_t *buffer, size_t offset, const unsigned char data[]
 			memcpy (tmp + tmp_offset + offset + size, ptr + offset, buffer->size - offset);
 		}
 
-		free (buffer->data);
+		dc_context_release (buffer->context, buffer->data);
 		buffer->data = tmp;
 		buffer->capacity = capacity;
 		buffer->offset = tmp_offset;
@@ -313,6 +368,22 @@ dc_buffer_slice (dc_buffer_t *buffer, size_t offset, size_t size)
 }
 
 
+int
+dc_buffer_view (dc_buffer_t *buffer, size_t offset, size_t size, dc_buffer_view_t *view)
+{
+	if (buffer == NULL || view == NULL)
+		return 0;
+
+	if (offset > buffer->size || size > buffer->size - offset)
+		return 0;
+
+	view->data = size ? buffer->data + buffer->offset + offset : NULL;
+	view->size = size;
+
+	return 1;
+}
+
+
 size_t
 dc_buffer_get_size (dc_buffer_t *buffer)
 {
@@ -26,6 +26,23 @@
 extern "C" {
 #endif /* __cplusplus */
 
+/*
+ * The implementations of the reflected CRCs. The regular functions pick
+ * the fastest one for the CPU; the others are only useful for testing
+ * and benchmarking. The hardware accelerated one (PCLMULQDQ on x86, the
+ * CRC32 instructions on ARMv8) only exists for the CRC-32, and falls
+ * back to slicing-by-8 for the other CRCs, and on a CPU without support.
+ */
+typedef enum checksum_impl_t {
+	CHECKSUM_IMPL_AUTO,
+	CHECKSUM_IMPL_BYTEWISE,
+	CHECKSUM_IMPL_SLICE8,
+	CHECKSUM_IMPL_HW,
+} checksum_impl_t;
+
+int
+checksum_impl_available (checksum_impl_t impl);
+
 unsigned char
 checksum_add_uint4 (const unsigned char data[], unsigned int size, unsigned char init);
 
@@ -47,18 +64,57 @@ checksum_crc16_ccitt (const unsigned char data[], unsigned int size, unsigned sh
 unsigned short
 checksum_crc16r_ccitt (const unsigned char data[], unsigned int size, unsigned short init, unsigned short xorout);
 
+unsigned short
+checksum_crc16r_ccitt_impl (checksum_impl_t impl, const unsigned char data[], unsigned int size, unsigned short init, unsigned short xorout);
+
 unsigned short
 checksum_crc16_ansi (const unsigned char data[], unsigned int size, unsigned short init, unsigned short xorout);
 
 unsigned short
 checksum_crc16r_ansi (const unsigned char data[], unsigned int size, unsigned short init, unsigned short xorout);
 
+unsigned short
+checksum_crc16r_ansi_impl (checksum_impl_t impl, const unsigned char data[], unsigned int size, unsigned short init, unsigned short xorout);
+
 unsigned int
 checksum_crc32r (const unsigned char data[], unsigned int size);
 
+unsigned int
+checksum_crc32r_impl (checksum_impl_t impl, const unsigned char data[], unsigned int size);
+
 unsigned int
 checksum_crc32 (const unsigned char data[], unsigned int size);
 
+/*
+ * Incremental computation of the CRCs above, for data that arrives in
+ * pieces. The init and xorout values are those of the corresponding
+ * function (0xffffffff for both CRC-32s). Feeding the pieces to the
+ * update function gives the same result as one call over all the data.
+ */
+typedef enum checksum_crc_type_t {
+	CHECKSUM_CRC16_CCITT,
+	CHECKSUM_CRC16R_CCITT,
+	CHECKSUM_CRC16_ANSI,
+	CHECKSUM_CRC16R_ANSI,
+	CHECKSUM_CRC32R,
+	CHECKSUM_CRC32,
+} checksum_crc_type_t;
+
+typedef struct checksum_crc_t {
+	checksum_crc_type_t type;
+	unsigned int value;
+	unsigned int xorout;
+} checksum_crc_t;
+
+void
+checksum_crc_init (checksum_crc_t *crc, checksum_crc_type_t type, unsigned int init, unsigned int xorout);
+
+void
+checksum_crc_update (checksum_crc_t *crc, const unsigned char data[], unsigned int size);
+
+unsigned int
+checksum_crc_final (const checksum_crc_t *crc);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
@@ -0,0 +1,175 @@
+/*
+ * libdivecomputer
+ *
+ * Copyright (C) 2023 Jules
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+/*
+ * Benchmark for the CRC implementations, built on demand with 'make
+ * checksum_bench'. Every implementation available on this CPU is run
+ * over random data, from the size of a single packet up to the size of
+ * a memory dump, and checked against the byte at a time one.
+ *
+ * Usage: ./checksum_bench [size ...]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "checksum.h"
+#include "timer.h"
+
+// The amount of data processed for every measurement.
+#define TOTAL (256 * 1024 * 1024)
+
+static const char *names[] = {
+	"auto", "bytewise", "slice8", "hw"
+};
+
+static const unsigned int defaults[] = {
+	64, 1024, 64 * 1024, 1024 * 1024, 16 * 1024 * 1024
+};
+
+typedef unsigned int (*crc_func_t) (checksum_impl_t impl, const unsigned char data[], unsigned int size);
+
+static unsigned int
+crc16r_ccitt (checksum_impl_t impl, const unsigned char data[], unsigned int size)
+{
+	return checksum_crc16r_ccitt_impl (impl, data, size, 0xFFFF, 0xFFFF);
+}
+
+static unsigned int
+crc16r_ansi (checksum_impl_t impl, const unsigned char data[], unsigned int size)
+{
+	return checksum_crc16r_ansi_impl (impl, data, size, 0xFFFF, 0x0000);
+}
+
+static const struct {
+	const char *name;
+	crc_func_t func;
+	int hw;
+} crcs[] = {
+	{"crc16r_ccitt", crc16r_ccitt, 0},
+	{"crc16r_ansi", crc16r_ansi, 0},
+	{"crc32r", checksum_crc32r_impl, 1},
+};
+
+static double
+bench (dc_timer_t *timer, crc_func_t func, checksum_impl_t impl, const unsigned char data[], unsigned int size, unsigned int *result)
+{
+	unsigned int iterations = TOTAL / size;
+	if (iterations == 0)
+		iterations = 1;
+
+	dc_usecs_t begin = 0, end = 0;
+	dc_timer_now (timer, &begin);
+	for (unsigned int i = 0; i < iterations; ++i) {
+		func (impl, data, size);
+	}
+	dc_timer_now (timer, &end);
+
+	*result = func (impl, data, size);
+
+	double seconds = (end - begin) / 1000000.0;
+	if (seconds <= 0.0)
+		return 0.0;
+
+	return (double) iterations * size / seconds / (1024.0 * 1024.0);
+}
+
+int
+main (int argc, char *argv[])
+{
+	const unsigned int *sizes = defaults;
+	unsigned int nsizes = sizeof (defaults) / sizeof (defaults[0]);
+	unsigned int *custom = NULL;
+	unsigned int maxsize = 0;
+	int errors = 0;
+
+	if (argc > 1) {
+		custom = (unsigned int *) malloc ((argc - 1) * sizeof (unsigned int));
+		if (custom == NULL)
+			return EXIT_FAILURE;
+		for (int i = 1; i < argc; ++i) {
+			unsigned long value = strtoul (argv[i], NULL, 0);
+			if (value == 0 || value > 0x7FFFFFFF) {
+				fprintf (stderr, "Usage: %s [size ...]\n", argv[0]);
+				free (custom);
+				return EXIT_FAILURE;
+			}
+			custom[i - 1] = value;
+		}
+		sizes = custom;
+		nsizes = argc - 1;
+	}
+
+	for (unsigned int i = 0; i < nsizes; ++i) {
+		if (maxsize < sizes[i])
+			maxsize = sizes[i];
+	}
+
+	unsigned char *data = (unsigned char *) malloc (maxsize);
+	dc_timer_t *timer = NULL;
+	if (data == NULL || dc_timer_new (&timer) != DC_STATUS_SUCCESS) {
+		fprintf (stderr, "Error: Failed to initialize.\n");
+		free (data);
+		free (custom);
+		return EXIT_FAILURE;
+	}
+
+	srand (1);
+	for (unsigned int i = 0; i < maxsize; ++i)
+		data[i] = rand () & 0xFF;
+
+	printf ("Hardware CRC: %s\n", checksum_impl_available (CHECKSUM_IMPL_HW) ? "yes" : "no");
+	printf ("%-14s %10s", "crc", "size");
+	for (unsigned int impl = CHECKSUM_IMPL_BYTEWISE; impl <= CHECKSUM_IMPL_HW; ++impl)
+		printf (" %10s", names[impl]);
+	printf ("   (MiB/s)\n");
+
+	for (unsigned int c = 0; c < sizeof (crcs) / sizeof (crcs[0]); ++c) {
+		for (unsigned int s = 0; s < nsizes; ++s) {
+			unsigned int reference = 0;
+			printf ("%-14s %10u", crcs[c].name, sizes[s]);
+			for (unsigned int impl = CHECKSUM_IMPL_BYTEWISE; impl <= CHECKSUM_IMPL_HW; ++impl) {
+				if (impl == CHECKSUM_IMPL_HW && (!crcs[c].hw || !checksum_impl_available (impl))) {
+					printf (" %10s", "-");
+					continue;
+				}
+
+				unsigned int result = 0;
+				double speed = bench (timer, crcs[c].func, impl, data, sizes[s], &result);
+				if (impl == CHECKSUM_IMPL_BYTEWISE)
+					reference = result;
+				if (result != reference) {
+					printf (" %10s", "MISMATCH");
+					errors++;
+				} else {
+					printf (" %10.0f", speed);
+				}
+			}
+			printf ("\n");
+		}
+	}
+
+	dc_timer_free (timer);
+	free (data);
+	free (custom);
+
+	return errors ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -113,7 +113,10 @@ static const dc_parser_vtable_t cochran_commander_parser_vtable = {
 	cochran_commander_parser_get_datetime, /* datetime */
 	cochran_commander_parser_get_field, /* fields */
 	cochran_commander_parser_samples_foreach, /* samples_foreach */
-	NULL /* destroy */
+	NULL, /* destroy */
+	NULL, /* samples_read */
+	NULL, /* reset */
+	NULL /* summary */
 };
 
 static const cochran_parser_layout_t cochran_cmdr_tm_parser_layout = {
@@ -64,6 +64,19 @@ dc_context_log (dc_context_t *context, dc_loglevel_t loglevel, const char *file,
 dc_status_t
 dc_context_syserror (dc_context_t *context, dc_loglevel_t loglevel, const char *file, unsigned int line, const char *function, int errcode);
 
+/*
+ * Allocate memory through the allocator of the context, or through the
+ * standard functions if there is no context.
+ */
+void *
+dc_context_alloc (dc_context_t *context, size_t size);
+
+void *
+dc_context_realloc (dc_context_t *context, void *ptr, size_t size);
+
+void
+dc_context_release (dc_context_t *context, void *ptr);
+
 dc_status_t
 dc_context_hexdump (dc_context_t *context, dc_loglevel_t loglevel, const char *file, unsigned int line, const char *function, const char *prefix, const unsigned char data[], unsigned int size);
 
@@ -42,6 +42,7 @@ struct dc_context_t {
 	dc_loglevel_t loglevel;
 	dc_logfunc_t logfunc;
 	void *userdata;
+	dc_allocator_t allocator;
 #ifdef ENABLE_LOGGING
 	char msg[16384 + 32];
 	dc_timer_t *timer;
@@ -124,6 +125,10 @@ dc_context_new (dc_context_t **out)
 	context->logfunc = NULL;
 #endif
 	context->userdata = NULL;
+	context->allocator.alloc = NULL;
+	context->allocator.resize = NULL;
+	context->allocator.release = NULL;
+	context->allocator.userdata = NULL;
 
 #ifdef ENABLE_LOGGING
 	memset (context->msg, 0, sizeof (context->msg));
@@ -177,6 +182,59 @@ dc_context_set_logfunc (dc_context_t *context, dc_logfunc_t logfunc, void *userd
 	return DC_STATUS_SUCCESS;
 }
 
+dc_status_t
+dc_context_set_allocator (dc_context_t *context, const dc_allocator_t *allocator)
+{
+	if (context == NULL)
+		return DC_STATUS_INVALIDARGS;
+
+	if (allocator == NULL) {
+		context->allocator.alloc = NULL;
+		context->allocator.resize = NULL;
+		context->allocator.release = NULL;
+		context->allocator.userdata = NULL;
+		return DC_STATUS_SUCCESS;
+	}
+
+	if (allocator->alloc == NULL || allocator->resize == NULL || allocator->release == NULL)
+		return DC_STATUS_INVALIDARGS;
+
+	context->allocator = *allocator;
+
+	return DC_STATUS_SUCCESS;
+}
+
+void *
+dc_context_alloc (dc_context_t *context, size_t size)
+{
+	if (context == NULL || context->allocator.alloc == NULL)
+		return malloc (size);
+
+	return context->allocator.alloc (size, context->allocator.userdata);
+}
+
+void *
+dc_context_realloc (dc_context_t *context, void *ptr, size_t size)
+{
+	if (context == NULL || context->allocator.resize == NULL)
+		return realloc (ptr, size);
+
+	return context->allocator.resize (ptr, size, context->allocator.userdata);
+}
+
+void
+dc_context_release (dc_context_t *context, void *ptr)
+{
+	if (context == NULL || context->allocator.release == NULL) {
+		free (ptr);
+		return;
+	}
+
+	if (ptr != NULL) {
+		context->allocator.release (ptr, context->allocator.userdata);
+	}
+}
+
 dc_status_t
 dc_context_log (dc_context_t *context, dc_loglevel_t loglevel, const char *file, unsigned int line, const char *function, const char *format, ...)
 {
@@ -67,7 +67,10 @@ static const dc_parser_vtable_t cressi_edy_parser_vtable = {
 	cressi_edy_parser_get_datetime, /* datetime */
 	cressi_edy_parser_get_field, /* fields */
 	cressi_edy_parser_samples_foreach, /* samples_foreach */
-	NULL /* destroy */
+	NULL, /* destroy */
+	NULL, /* samples_read */
+	NULL, /* reset */
+	NULL /* summary */
 };
 
 static const cressi_edy_layout_t edy = {
@@ -82,7 +82,10 @@ static const dc_parser_vtable_t cressi_goa_parser_vtable = {
 	cressi_goa_parser_get_datetime, /* datetime */
 	cressi_goa_parser_get_field, /* fields */
 	cressi_goa_parser_samples_foreach, /* samples_foreach */
-	NULL /* destroy */
+	NULL, /* destroy */
+	NULL, /* samples_read */
+	NULL, /* reset */
+	NULL /* summary */
 };
 
 static const cressi_goa_layout_t scuba_nitrox_layout_v0 = {
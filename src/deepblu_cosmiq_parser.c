@@ -55,7 +55,10 @@ static const dc_parser_vtable_t deepblu_cosmiq_parser_vtable = {
 	deepblu_cosmiq_parser_get_datetime, /* datetime */
 	deepblu_cosmiq_parser_get_field, /* fields */
 	deepblu_cosmiq_parser_samples_foreach, /* samples_foreach */
-	NULL /* destroy */
+	NULL, /* destroy */
+	NULL, /* samples_read */
+	NULL, /* reset */
+	NULL /* summary */
 };
 
 dc_status_t
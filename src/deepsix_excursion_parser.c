@@ -128,7 +128,10 @@ static const dc_parser_vtable_t deepsix_parser_vtable = {
 	deepsix_excursion_parser_get_datetime, /* datetime */
 	deepsix_excursion_parser_get_field, /* fields */
 	deepsix_excursion_parser_samples_foreach, /* samples_foreach */
-	NULL /* destroy */
+	NULL, /* destroy */
+	NULL, /* samples_read */
+	NULL, /* reset */
+	NULL /* summary */
 };
 
 static const deepsix_excursion_layout_t deepsix_excursion_layout_v0 = {
@@ -72,6 +72,8 @@ typedef struct divesoft_freedom_device_t {
 	dc_iostream_t *iostream;
 	unsigned char fingerprint[FINGERPRINT_SIZE];
 	unsigned int seqnum;
+	divesoft_freedom_data_callback_t datacallback;
+	void *datauserdata;
 } divesoft_freedom_device_t;
 
 static dc_status_t divesoft_freedom_device_set_fingerprint (dc_device_t *abstract, const unsigned char data[], unsigned int size);
@@ -90,6 +92,8 @@ static const dc_device_vtable_t divesoft_freedom_device_vtable = {
 	divesoft_freedom_device_close, /* close */
 };
 
+#define ISINSTANCE(device) dc_device_isinstance((device), &divesoft_freedom_device_vtable)
+
 static dc_status_t
 divesoft_freedom_send (divesoft_freedom_device_t *device, message_t message, const unsigned char data[], size_t size)
 {
@@ -185,8 +189,13 @@ divesoft_freedom_recv (divesoft_freedom_device_t *device, dc_event_progress_t *p
 			return DC_STATUS_PROTOCOL;
 		}
 
-		unsigned short crc = array_uint16_le (packet + len - 2);
-		unsigned short ccrc = checksum_crc16r_ccitt (packet, len - 2, 0xFFFF, 0xFFFF);
+		unsigned int crc = array_uint16_le (packet + len - 2);
+		unsigned int ccrc = 0;
+		status = dc_hdlc_get_checksum (device->iostream, &ccrc);
+		if (status != DC_STATUS_SUCCESS) {
+			ERROR (abstract->context, "Failed to get the packet checksum.");
+			return status;
+		}
 		if (crc != ccrc) {
 			ERROR (abstract->context, "Unexpected packet checksum (%04x %04x).", crc, ccrc);
 			return DC_STATUS_PROTOCOL;
@@ -204,6 +213,11 @@ divesoft_freedom_recv (divesoft_freedom_device_t *device, dc_event_progress_t *p
 			device_event_emit (abstract, DC_EVENT_PROGRESS, progress);
 		}
 
+		// Pass the dive data on as it arrives.
+		if (type == MSG_DIVE_DATA_RSP && device->datacallback) {
+			device->datacallback (packet + 6, len - 8, dc_buffer_get_size (buffer), device->datauserdata);
+		}
+
 		if (!dc_buffer_append (buffer, packet + 6, len - 8)) {
 			ERROR (abstract->context, "Insufficient buffer space available.");
 			return DC_STATUS_NOMEMORY;
@@ -310,6 +324,8 @@ divesoft_freedom_device_open (dc_device_t **out, dc_context_t *context, dc_iostr
 	device->iostream = NULL;
 	memset(device->fingerprint, 0, sizeof(device->fingerprint));
 	device->seqnum = 0;
+	device->datacallback = NULL;
+	device->datauserdata = NULL;
 
 	// Setup the HDLC communication.
 	status = dc_hdlc_open (&device->iostream, context, iostream, 244, 244);
@@ -318,6 +334,9 @@ divesoft_freedom_device_open (dc_device_t **out, dc_context_t *context, dc_iostr
 		goto error_free;
 	}
 
+	// Verify the packet checksums while the packets are received.
+	dc_hdlc_set_checksum (device->iostream, CHECKSUM_CRC16R_CCITT, 0xFFFF, 0xFFFF, 2);
+
 	// Set the serial communication protocol (115200 8N1).
 	status = dc_iostream_configure (device->iostream, 115200, 8, DC_PARITY_NONE, DC_STOPBITS_ONE, DC_FLOWCONTROL_NONE);
 	if (status != DC_STATUS_SUCCESS) {
@@ -370,6 +389,20 @@ divesoft_freedom_device_close (dc_device_t *abstract)
 	return dc_iostream_close (device->iostream);
 }
 
+dc_status_t
+divesoft_freedom_device_set_data_callback (dc_device_t *abstract, divesoft_freedom_data_callback_t callback, void *userdata)
+{
+	divesoft_freedom_device_t *device = (divesoft_freedom_device_t *) abstract;
+
+	if (!ISINSTANCE (abstract))
+		return DC_STATUS_INVALIDARGS;
+
+	device->datacallback = callback;
+	device->datauserdata = userdata;
+
+	return DC_STATUS_SUCCESS;
+}
+
 static dc_status_t
 divesoft_freedom_device_set_fingerprint (dc_device_t *abstract, const unsigned char data[], unsigned int size)
 {
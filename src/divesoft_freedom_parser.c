@@ -23,6 +23,14 @@
 #include <string.h>
 #include <stdio.h>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define HAVE_SSE2
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define HAVE_NEON
+#endif
+
 #include <libdivecomputer/units.h>
 
 #include "divesoft_freedom.h"
@@ -49,7 +57,34 @@
 #define HEADER_SIZE_V1 32
 #define HEADER_SIZE_V2 64
 
+// Every record starts with a 32 bit word with the type, the timestamp and
+// the id. The V2 logs also set the top bit, which is not part of the id.
 #define RECORD_SIZE 16
+#define RECORD_TYPES 16
+#define RECORD_EMPTY 0xFF
+
+// The record types needed by the cache pass.
+#define CACHE_RECORDS ( \
+	(1u << LREC_MANIPULATION) | (1u << LREC_AUTO) | (1u << LREC_DIVER_ERROR) | \
+	(1u << LREC_INTERNAL_ERROR) | (1u << LREC_ACTIVITY) | (1u << LREC_INFO) | \
+	(1u << LREC_CONFIGURATION) | (1u << LREC_MEASURE))
+
+// The maximum number of samples produced by a single record: the time,
+// the initial diluent and the pressure of every tank.
+#define MAXSAMPLES (2 + NTANKS)
+
+// The lookup tables of the sample decoding. The tanks are mapped directly
+// by the transmitter (the index in the pressure records), and the gas
+// mixes with an open addressing hash table of their composition, twice
+// as large as the maximum number of gas mixes.
+#define TANKMAP_NONE 0xFF
+#define GASMAP_BITS  5
+#define GASMAP_SIZE  (1u << GASMAP_BITS)
+
+// The largest jump forward in time (in seconds) accepted without
+// confirmation by the next record, when resynchronising in tolerant mode.
+#define RESYNC_GAP 600
+#define RESYNC_ANY 0x1FFFF
 
 #define SEAWATER   1028
 #define FRESHWATER 1000
@@ -230,11 +265,72 @@ typedef struct divesoft_freedom_tank_t {
 	unsigned int active;
 } divesoft_freedom_tank_t;
 
+/*
+ * A header field: an integer of the given size (1, 2 or 4 bytes, or 0 if
+ * not present) at the offset, of which the value is the bit field at the
+ * shift.
+ */
+typedef struct divesoft_freedom_field_t {
+	unsigned int offset;
+	unsigned int size;
+	unsigned int shift;
+	unsigned int bits;
+	unsigned int sign;
+} divesoft_freedom_field_t;
+
+typedef struct divesoft_freedom_layout_t {
+	unsigned int signature;
+	unsigned int headersize;
+	unsigned int timezone; // Offset of the timezone, or 0 if not present.
+	divesoft_freedom_field_t divetime;
+	divesoft_freedom_field_t divemode;
+	divesoft_freedom_field_t temperature_min;
+	divesoft_freedom_field_t maxdepth;
+	divesoft_freedom_field_t avgdepth;
+	divesoft_freedom_field_t atmospheric;
+	divesoft_freedom_field_t diluent_o2;
+	divesoft_freedom_field_t diluent_he;
+} divesoft_freedom_layout_t;
+
+// The header layouts. The V1 header (Freedom, Liberty) packs several
+// fields into bit fields; the V2 header (Freedom+, .DLF files) is larger,
+// and stores every field separately.
+static const divesoft_freedom_layout_t divesoft_freedom_layouts[] = {
+	{HEADER_SIGNATURE_V1, HEADER_SIZE_V1, 0,
+		{12, 4,  0, 17, 0}, /* divetime */
+		{12, 4, 27,  3, 0}, /* divemode */
+		{16, 4, 18, 10, 1}, /* temperature_min */
+		{20, 2,  0, 16, 0}, /* maxdepth */
+		{ 0, 0,  0,  0, 0}, /* avgdepth */
+		{24, 2,  0, 16, 0}, /* atmospheric */
+		{26, 1,  0,  8, 0}, /* diluent_o2 */
+		{27, 1,  0,  8, 0}, /* diluent_he */
+	},
+	{HEADER_SIGNATURE_V2, HEADER_SIZE_V2, 40,
+		{12, 4,  0, 32, 0}, /* divetime */
+		{18, 1,  0,  8, 0}, /* divemode */
+		{24, 2,  0, 16, 1}, /* temperature_min */
+		{28, 2,  0, 16, 0}, /* maxdepth */
+		{30, 2,  0, 16, 0}, /* avgdepth */
+		{32, 2,  0, 16, 0}, /* atmospheric */
+		{44, 1,  0,  8, 0}, /* diluent_o2 */
+		{45, 1,  0,  8, 0}, /* diluent_he */
+	},
+};
+
+typedef struct divesoft_freedom_cursor_t {
+	unsigned int position;
+	unsigned int time;
+	unsigned int initial;
+} divesoft_freedom_cursor_t;
+
 typedef struct divesoft_freedom_parser_t {
 	dc_parser_t base;
-	// Cached fields.
+	// Cached fields. The fields of the dive header are cached first, and
+	// the others only once the profile is needed.
+	unsigned int header_cached;
 	unsigned int cached;
-	unsigned int version;
+	const divesoft_freedom_layout_t *layout;
 	unsigned int headersize;
 	unsigned int divetime;
 	unsigned int divemode;
@@ -247,6 +343,8 @@ typedef struct divesoft_freedom_parser_t {
 	unsigned int diluent;
 	unsigned int ntanks;
 	divesoft_freedom_tank_t tank[NTANKS];
+	unsigned char tankmap[NTANKS];
+	unsigned char gasmap[GASMAP_SIZE];
 	unsigned int vpm;
 	unsigned int gf_lo;
 	unsigned int gf_hi;
@@ -256,11 +354,47 @@ typedef struct divesoft_freedom_parser_t {
 	unsigned int have_location;
 	int latitude;
 	int longitude;
+	// Offsets and types of the non-empty profile records, collected by
+	// the cache pass, so the sample pass does not have to scan the data
+	// again.
+	unsigned int *records;
+	unsigned char *types;
+	unsigned int nrecords;
+	// Random access index, built on demand. For every record, the
+	// timestamp (made non-decreasing, to allow a binary search), and the
+	// positions of the records grouped by type.
+	unsigned int indexed;
+	unsigned int *times;
+	unsigned int *bytype;
+	unsigned int typestart[RECORD_TYPES + 1];
+	// Tissue timeline, decoded on demand.
+	unsigned int tissues_cached;
+	divesoft_freedom_tissue_t *tissues;
+	unsigned int ntissues;
+	// Tolerant mode, and the parts of the data that were skipped.
+	unsigned int tolerant;
+	divesoft_freedom_range_t *ranges;
+	unsigned int nranges;
+	unsigned int maxranges;
+	// Incremental parsing: gas mixes that are not known yet are added
+	// when they show up in a gas change.
+	unsigned int incremental;
+	// Batched sample reading. The samples of a record that did not fit
+	// into the caller's array are kept until the next call.
+	divesoft_freedom_cursor_t cursor;
+	dc_status_t cursor_status;
+	dc_sample_t pending[MAXSAMPLES];
+	unsigned int npending;
+	unsigned int pendingpos;
 } divesoft_freedom_parser_t;
 
 static dc_status_t divesoft_freedom_parser_get_datetime (dc_parser_t *abstract, dc_datetime_t *datetime);
 static dc_status_t divesoft_freedom_parser_get_field (dc_parser_t *abstract, dc_field_type_t type, unsigned int flags, void *value);
 static dc_status_t divesoft_freedom_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callback_t callback, void *userdata);
+static dc_status_t divesoft_freedom_parser_destroy (dc_parser_t *abstract);
+static dc_status_t divesoft_freedom_parser_samples_read (dc_parser_t *abstract, dc_sample_t samples[], unsigned int count, unsigned int *actual);
+static dc_status_t divesoft_freedom_parser_reset (dc_parser_t *abstract);
+static dc_status_t divesoft_freedom_parser_get_summary (dc_parser_t *abstract, dc_summary_t *summary);
 
 static const dc_parser_vtable_t divesoft_freedom_parser_vtable = {
 	sizeof(divesoft_freedom_parser_t),
@@ -271,9 +405,14 @@ static const dc_parser_vtable_t divesoft_freedom_parser_vtable = {
 	divesoft_freedom_parser_get_datetime, /* datetime */
 	divesoft_freedom_parser_get_field, /* fields */
 	divesoft_freedom_parser_samples_foreach, /* samples_foreach */
-	NULL /* destroy */
+	divesoft_freedom_parser_destroy, /* destroy */
+	divesoft_freedom_parser_samples_read, /* samples_read */
+	divesoft_freedom_parser_reset, /* reset */
+	divesoft_freedom_parser_get_summary /* summary */
 };
 
+#define ISINSTANCE(parser) dc_parser_isinstance((parser), &divesoft_freedom_parser_vtable)
+
 static unsigned int
 divesoft_freedom_find_gasmix (divesoft_freedom_gasmix_t gasmix[], unsigned int count, unsigned int oxygen, unsigned int helium, unsigned int type)
 {
@@ -290,16 +429,74 @@ divesoft_freedom_find_gasmix (divesoft_freedom_gasmix_t gasmix[], unsigned int c
 }
 
 static unsigned int
-divesoft_freedom_find_tank (divesoft_freedom_tank_t tank[], unsigned int count, unsigned int transmitter)
+divesoft_freedom_gasmix_hash (unsigned int oxygen, unsigned int helium, unsigned int type)
 {
-	unsigned int i = 0;
-	while (i < count) {
-		if (transmitter == tank[i].transmitter)
-			break;
-		i++;
+	unsigned int key = (oxygen << 10) | (helium << 2) | type;
+
+	return (key * 0x9E3779B1u) >> (32 - GASMAP_BITS);
+}
+
+/*
+ * Fill the hash table of the gas mixes. The table holds the index plus
+ * one, with zero for an empty slot. Like divesoft_freedom_find_gasmix,
+ * the first of several identical gas mixes is the one that is found.
+ */
+static void
+divesoft_freedom_map_gasmixes (unsigned char map[], const divesoft_freedom_gasmix_t gasmix[], unsigned int count)
+{
+	memset (map, 0, GASMAP_SIZE);
+
+	for (unsigned int i = 0; i < count; ++i) {
+		unsigned int h = divesoft_freedom_gasmix_hash (gasmix[i].oxygen, gasmix[i].helium, gasmix[i].type);
+		while (map[h]) {
+			const divesoft_freedom_gasmix_t *other = &gasmix[map[h] - 1];
+			if (other->oxygen == gasmix[i].oxygen &&
+				other->helium == gasmix[i].helium &&
+				other->type == gasmix[i].type)
+				break;
+			h = (h + 1) & (GASMAP_SIZE - 1);
+		}
+		if (map[h] == 0) {
+			map[h] = i + 1;
+		}
 	}
+}
 
-	return i;
+static unsigned int
+divesoft_freedom_lookup_gasmix (const unsigned char map[], const divesoft_freedom_gasmix_t gasmix[], unsigned int count, unsigned int oxygen, unsigned int helium, unsigned int type)
+{
+	unsigned int h = divesoft_freedom_gasmix_hash (oxygen, helium, type);
+	while (map[h]) {
+		unsigned int i = map[h] - 1;
+		if (oxygen == gasmix[i].oxygen &&
+			helium == gasmix[i].helium &&
+			type == gasmix[i].type)
+			return i;
+		h = (h + 1) & (GASMAP_SIZE - 1);
+	}
+
+	return count;
+}
+
+/*
+ * Append a gas mix, when parsing incrementally. Returns the index of the
+ * gas mix, or the number of gas mixes if there is no room left.
+ */
+static unsigned int
+divesoft_freedom_add_gasmix (divesoft_freedom_parser_t *parser, unsigned int oxygen, unsigned int helium, unsigned int type)
+{
+	if (parser->ngasmixes >= NGASMIXES)
+		return parser->ngasmixes;
+
+	unsigned int idx = parser->ngasmixes++;
+	parser->gasmix[idx].oxygen = oxygen;
+	parser->gasmix[idx].helium = helium;
+	parser->gasmix[idx].type = type;
+	parser->gasmix[idx].id = UNDEFINED;
+
+	divesoft_freedom_map_gasmixes (parser->gasmap, parser->gasmix, parser->ngasmixes);
+
+	return idx;
 }
 
 static unsigned int
@@ -310,88 +507,344 @@ divesoft_freedom_is_ccr (unsigned int divemode)
 		divemode == STMODE_BOCCR;
 }
 
-static dc_status_t
-divesoft_freedom_cache (divesoft_freedom_parser_t *parser)
+static unsigned int
+divesoft_freedom_field (const unsigned char data[], const divesoft_freedom_field_t *field)
 {
-	dc_parser_t *abstract = (dc_parser_t *) parser;
-	const unsigned char *data = abstract->data;
-	unsigned int size = abstract->size;
+	unsigned int value = 0;
+
+	switch (field->size) {
+	case 1:
+		value = data[field->offset];
+		break;
+	case 2:
+		value = array_uint16_le (data + field->offset);
+		break;
+	case 4:
+		value = array_uint32_le (data + field->offset);
+		break;
+	default:
+		return 0;
+	}
 
-	if (parser->cached) {
-		return DC_STATUS_SUCCESS;
+	value >>= field->shift;
+	if (field->bits < 32)
+		value &= (1u << field->bits) - 1;
+	if (field->sign)
+		value = signextend (value, field->bits);
+
+	return value;
+}
+
+/*
+ * Find the layout of the header with the given signature.
+ */
+static const divesoft_freedom_layout_t *
+divesoft_freedom_find_layout (unsigned int signature)
+{
+	for (unsigned int i = 0; i < C_ARRAY_SIZE (divesoft_freedom_layouts); ++i) {
+		if (divesoft_freedom_layouts[i].signature == signature)
+			return divesoft_freedom_layouts + i;
 	}
 
-	unsigned int headersize = 4;
-	if (size < headersize) {
-		ERROR (abstract->context, "Unexpected header size (%u).", size);
+	return NULL;
+}
+
+/*
+ * Check the signature, the size and the checksum of the header, and
+ * return the matching layout.
+ */
+static dc_status_t
+divesoft_freedom_check_header (dc_context_t *context, const unsigned char data[], unsigned int size, const divesoft_freedom_layout_t **layout)
+{
+	if (size < 4) {
+		ERROR (context, "Unexpected header size (%u).", size);
 		return DC_STATUS_DATAFORMAT;
 	}
 
-	unsigned int version = array_uint32_le (data);
-	if (version == HEADER_SIGNATURE_V1) {
-		headersize = HEADER_SIZE_V1;
-	} else if (version == HEADER_SIGNATURE_V2) {
-		headersize = HEADER_SIZE_V2;
-	} else {
-		ERROR (abstract->context, "Unexpected header version (%08x).", version);
+	unsigned int signature = array_uint32_le (data);
+	const divesoft_freedom_layout_t *header = divesoft_freedom_find_layout (signature);
+	if (header == NULL) {
+		ERROR (context, "Unexpected header version (%08x).", signature);
 		return DC_STATUS_DATAFORMAT;
 	}
 
-	if (size < headersize) {
-		ERROR (abstract->context, "Unexpected header size (%u).", size);
+	if (size < header->headersize) {
+		ERROR (context, "Unexpected header size (%u).", size);
 		return DC_STATUS_DATAFORMAT;
 	}
 
-	// JULES: Disabling checksum validation to debug the .DLF file format.
-	// The file provided by the user fails this check. I will proceed with parsing
-	// to analyze the rest of the data structure.
-	// unsigned short crc = array_uint16_le (data + 4);
-	// unsigned short ccrc = checksum_crc16r_ansi (data + 6, headersize - 6, 0xFFFF, 0x0000);
-	// if (crc != ccrc) {
-	// 	ERROR (abstract->context, "Invalid header checksum (%04x %04x).", crc, ccrc);
-	// 	return DC_STATUS_DATAFORMAT;
-	// }
-
-	// Parse the dive header.
-	unsigned int divetime = 0;
-	unsigned int divemode = 0;
-	unsigned int temperature_min = 0;
-	unsigned int maxdepth = 0;
-	unsigned int atmospheric = 0;
-	unsigned int avgdepth = 0;
-	unsigned int diluent_o2 = 0, diluent_he = 0;
-	if (version == HEADER_SIGNATURE_V1) {
-		unsigned int misc1 = array_uint32_le (data + 12);
-		unsigned int misc2 = array_uint32_le (data + 16);
-		divetime = misc1 & 0x1FFFF;
-		divemode = (misc1 & 0x38000000) >> 27;
-		temperature_min = (signed int) signextend ((misc2 & 0xFFC0000) >> 18, 10);
-		maxdepth = array_uint16_le (data + 20);
-		atmospheric = array_uint16_le (data + 24);
-		avgdepth = 0;
-		diluent_o2 = data[26];
-		diluent_he = data[27];
-	} else {
-		// JULES HACK: The user's .DLF file has a V2 header signature ('DiVE')
-		// but the data layout seems to match the V1 format.
-		// I am replacing the V2 parsing logic with the V1 logic as an experiment.
-		// AND forcing the header size to 32 bytes.
-		headersize = HEADER_SIZE_V1;
-		unsigned int misc1 = array_uint32_le (data + 12);
-		unsigned int misc2 = array_uint32_le (data + 16);
-		divetime = misc1 & 0x1FFFF;
-		divemode = (misc1 & 0x38000000) >> 27;
-		temperature_min = (signed int) signextend ((misc2 & 0xFFC0000) >> 18, 10);
-		maxdepth = array_uint16_le (data + 20);
-		atmospheric = array_uint16_le (data + 24);
-		avgdepth = 0; // V1 format does not have avgdepth in header
-		diluent_o2 = data[26];
-		diluent_he = data[27];
+	unsigned short crc = array_uint16_le (data + 4);
+	unsigned short ccrc = checksum_crc16r_ansi (data + 6, header->headersize - 6, 0xFFFF, 0x0000);
+	if (crc != ccrc) {
+		ERROR (context, "Invalid header checksum (%04x %04x).", crc, ccrc);
+		return DC_STATUS_DATAFORMAT;
+	}
+
+	*layout = header;
+
+	return DC_STATUS_SUCCESS;
+}
+
+/*
+ * Classify a block of records: store the type of every record, or
+ * RECORD_EMPTY for the unused records (filled with 0xFF). A record is
+ * exactly one 128 bit vector, so the empty test is a single compare.
+ */
+static void
+divesoft_freedom_classify (const unsigned char data[], unsigned int count, unsigned char types[])
+{
+	for (unsigned int i = 0; i < count; ++i) {
+		const unsigned char *record = data + i * RECORD_SIZE;
+#if defined(HAVE_SSE2)
+		__m128i value = _mm_loadu_si128 ((const __m128i *) record);
+		__m128i ones = _mm_cmpeq_epi8 (value, value);
+		int empty = _mm_movemask_epi8 (_mm_cmpeq_epi8 (value, ones)) == 0xFFFF;
+#elif defined(HAVE_NEON)
+		int empty = vminvq_u8 (vld1q_u8 (record)) == 0xFF;
+#else
+		int empty = (array_uint32_le (record) & array_uint32_le (record + 4) &
+			array_uint32_le (record + 8) & array_uint32_le (record + 12)) == 0xFFFFFFFF;
+#endif
+		types[i] = empty ? RECORD_EMPTY : (record[0] & 0x0F);
+	}
+}
+
+/*
+ * Record a skipped part of the data. A range that directly follows the
+ * previous one, for the same reason, is merged into it.
+ */
+static dc_status_t
+divesoft_freedom_skip (divesoft_freedom_parser_t *parser, unsigned int offset, unsigned int size, unsigned int reason)
+{
+	dc_parser_t *abstract = (dc_parser_t *) parser;
+
+	WARNING (abstract->context, "Skipping %u bytes at offset %u (reason %u).", size, offset, reason);
+
+	if (parser->nranges) {
+		divesoft_freedom_range_t *last = &parser->ranges[parser->nranges - 1];
+		if (last->reason == reason && last->offset + last->size == offset) {
+			last->size += size;
+			return DC_STATUS_SUCCESS;
+		}
+	}
+
+	if (parser->nranges >= parser->maxranges) {
+		unsigned int maxranges = parser->maxranges ? parser->maxranges * 2 : 16;
+		divesoft_freedom_range_t *ranges = (divesoft_freedom_range_t *) dc_context_realloc (abstract->context, parser->ranges, maxranges * sizeof (divesoft_freedom_range_t));
+		if (ranges == NULL) {
+			ERROR (abstract->context, "Failed to allocate memory.");
+			return DC_STATUS_NOMEMORY;
+		}
+		parser->ranges = ranges;
+		parser->maxranges = maxranges;
+	}
+
+	parser->ranges[parser->nranges].offset = offset;
+	parser->ranges[parser->nranges].size = size;
+	parser->ranges[parser->nranges].reason = reason;
+	parser->nranges++;
+
+	return DC_STATUS_SUCCESS;
+}
+
+/*
+ * Check whether a record can follow a record with the given timestamp:
+ * a known type, and a timestamp that does not jump back by more than the
+ * sample decoding tolerates, or forward by more than the given gap.
+ * Returns the reason to skip the record, or zero.
+ */
+static unsigned int
+divesoft_freedom_check_record (const unsigned char data[], unsigned int time, unsigned int gap)
+{
+	unsigned int flags = array_uint32_le (data);
+	unsigned int type = flags & 0x0F;
+	unsigned int timestamp = (flags & 0x001FFFF0) >> 4;
+
+	if (type > LREC_INFO)
+		return DIVESOFT_FREEDOM_SKIP_TYPE;
+
+	if (time == UNDEFINED)
+		time = 0;
+	else if (timestamp + 5 < time)
+		return DIVESOFT_FREEDOM_SKIP_TIMESTAMP;
+
+	if (timestamp > time + gap)
+		return DIVESOFT_FREEDOM_SKIP_TIMESTAMP;
+
+	return 0;
+}
+
+/*
+ * Check whether a record is confirmed by the given number of records
+ * after it, each following the previous one. The end of the data, or an
+ * empty record, ends the chain early.
+ */
+static int
+divesoft_freedom_confirmed (const unsigned char data[], unsigned int size, unsigned int offset, unsigned int count)
+{
+	for (unsigned int i = 0; i < count; ++i) {
+		unsigned int next = offset + RECORD_SIZE;
+		if (next + RECORD_SIZE > size || array_isequal (data + next, RECORD_SIZE, 0xFF))
+			break;
+
+		unsigned int timestamp = (array_uint32_le (data + offset) & 0x001FFFF0) >> 4;
+		if (divesoft_freedom_check_record (data + next, timestamp, RESYNC_GAP) != 0)
+			return 0;
+
+		offset = next;
+	}
+
+	return 1;
+}
+
+/*
+ * Collect the records in tolerant mode. A record that does not fit into
+ * the sequence is skipped, together with the bytes up to the next
+ * plausible record: preferably the next record in line, otherwise a
+ * record at any other offset that is confirmed by the two after it (to
+ * get back in sync after missing or extra bytes). Large jumps forward in
+ * time are only accepted with a confirmation.
+ */
+static dc_status_t
+divesoft_freedom_scan (divesoft_freedom_parser_t *parser, unsigned int headersize, unsigned int records[], unsigned char types[], unsigned int *count)
+{
+	dc_status_t status = DC_STATUS_SUCCESS;
+	dc_parser_t *abstract = (dc_parser_t *) parser;
+	const unsigned char *data = abstract->data;
+	unsigned int size = abstract->size;
+
+	unsigned int nrecords = 0;
+	unsigned int time = UNDEFINED;
+	unsigned int offset = headersize;
+	while (offset + RECORD_SIZE <= size) {
+		if (array_isequal (data + offset, RECORD_SIZE, 0xFF)) {
+			WARNING (abstract->context, "Skipping empty sample.");
+			offset += RECORD_SIZE;
+			continue;
+		}
 
+		unsigned int reason = divesoft_freedom_check_record (data + offset, time, RESYNC_GAP);
+		if (reason == DIVESOFT_FREEDOM_SKIP_TIMESTAMP &&
+			divesoft_freedom_check_record (data + offset, time, RESYNC_ANY) == 0 &&
+			divesoft_freedom_confirmed (data, size, offset, 1)) {
+			reason = 0;
+		}
+
+		if (reason) {
+			// Search the next plausible record. Only if the next record
+			// in line is not, the records are assumed to be shifted.
+			unsigned int next = offset + RECORD_SIZE;
+			if (next + RECORD_SIZE <= size &&
+				!array_isequal (data + next, RECORD_SIZE, 0xFF) &&
+				(divesoft_freedom_check_record (data + next, time, RESYNC_GAP) != 0 ||
+				!divesoft_freedom_confirmed (data, size, next, 1))) {
+				next = offset + 1;
+				while (next + RECORD_SIZE <= size && (next - offset) % RECORD_SIZE != 0) {
+					if (divesoft_freedom_check_record (data + next, time, RESYNC_GAP) == 0 &&
+						divesoft_freedom_confirmed (data, size, next, 2))
+						break;
+					next++;
+				}
+			}
+			if (next + RECORD_SIZE > size)
+				next = size;
+
+			status = divesoft_freedom_skip (parser, offset, next - offset, reason);
+			if (status != DC_STATUS_SUCCESS)
+				return status;
+
+			offset = next;
+			continue;
+		}
+
+		unsigned int timestamp = (array_uint32_le (data + offset) & 0x001FFFF0) >> 4;
+		if (timestamp > time || time == UNDEFINED)
+			time = timestamp;
+
+		records[nrecords] = offset;
+		types[nrecords] = data[offset] & 0x0F;
+		nrecords++;
+
+		offset += RECORD_SIZE;
+	}
+
+	if (offset < size) {
+		status = divesoft_freedom_skip (parser, offset, size - offset, DIVESOFT_FREEDOM_SKIP_TRUNCATED);
+		if (status != DC_STATUS_SUCCESS)
+			return status;
+	}
+
+	*count = nrecords;
+
+	return DC_STATUS_SUCCESS;
+}
+
+/*
+ * Cache the fields of the dive header. This only reads the header, so
+ * it is cheap enough for listing a whole logbook.
+ */
+static dc_status_t
+divesoft_freedom_cache_header (divesoft_freedom_parser_t *parser)
+{
+	dc_status_t status = DC_STATUS_SUCCESS;
+	dc_parser_t *abstract = (dc_parser_t *) parser;
+	const unsigned char *data = abstract->data;
+
+	if (parser->header_cached) {
+		return DC_STATUS_SUCCESS;
+	}
+
+	const divesoft_freedom_layout_t *layout = NULL;
+	status = divesoft_freedom_check_header (abstract->context, data, abstract->size, &layout);
+	if (status != DC_STATUS_SUCCESS)
+		return status;
+
+	if (layout->signature == HEADER_SIGNATURE_V2) {
 		DEBUG (abstract->context, "Device: serial=%.4s-%.8s",
 			data + 52, data + 56);
 	}
 
+	parser->header_cached = 1;
+	parser->layout = layout;
+	parser->headersize = layout->headersize;
+	parser->divetime = divesoft_freedom_field (data, &layout->divetime);
+	parser->divemode = divesoft_freedom_field (data, &layout->divemode);
+	parser->temperature_min = divesoft_freedom_field (data, &layout->temperature_min);
+	parser->maxdepth = divesoft_freedom_field (data, &layout->maxdepth);
+	parser->atmospheric = divesoft_freedom_field (data, &layout->atmospheric);
+	parser->avgdepth = divesoft_freedom_field (data, &layout->avgdepth);
+
+	return DC_STATUS_SUCCESS;
+}
+
+/*
+ * Cache the fields that need the dive profile (the gas mixes, tanks,
+ * deco settings, calibration and location), along with the record index.
+ */
+static dc_status_t
+divesoft_freedom_cache (divesoft_freedom_parser_t *parser)
+{
+	dc_status_t status = DC_STATUS_SUCCESS;
+	dc_parser_t *abstract = (dc_parser_t *) parser;
+	const unsigned char *data = abstract->data;
+	unsigned int size = abstract->size;
+
+	if (parser->cached) {
+		return DC_STATUS_SUCCESS;
+	}
+
+	status = divesoft_freedom_cache_header (parser);
+	if (status != DC_STATUS_SUCCESS)
+		return status;
+
+	parser->nranges = 0;
+
+	const divesoft_freedom_layout_t *layout = parser->layout;
+	unsigned int headersize = parser->headersize;
+	unsigned int divemode = parser->divemode;
+	unsigned int diluent_o2 = divesoft_freedom_field (data, &layout->diluent_o2);
+	unsigned int diluent_he = divesoft_freedom_field (data, &layout->diluent_he);
+
 	divesoft_freedom_gasmix_t gasmix_ai[NGASMIXES] = {0},
 		gasmix_diluent[NGASMIXES] = {0},
 		gasmix_event[NGASMIXES] = {0};
@@ -399,8 +852,13 @@ divesoft_freedom_cache (divesoft_freedom_parser_t *parser)
 		ngasmix_diluent = 0,
 		ngasmix_event = 0;
 	divesoft_freedom_tank_t tank[NTANKS] = {0};
+	unsigned char tankmap[NTANKS];
 	unsigned int ntanks = 0;
 
+	// Tank of every transmitter, kept up to date while the tanks are
+	// added. Only the first tank of a transmitter can be found.
+	memset (tankmap, TANKMAP_NONE, sizeof (tankmap));
+
 	unsigned int vpm = 0, gf_lo = 0, gf_hi = 0;
 	unsigned int seawater = 0;
 	unsigned int calibration[NSENSORS] = {0};
@@ -412,18 +870,61 @@ divesoft_freedom_cache (divesoft_freedom_parser_t *parser)
 	int latitude = 0;
 	int longitude = 0;
 
-	// Parse the dive profile.
-	unsigned int offset = headersize;
-	while (offset + RECORD_SIZE <= size) {
-		if (array_isequal(data + offset, RECORD_SIZE, 0xFF)) {
-			WARNING (abstract->context, "Skipping empty sample.");
-			offset += RECORD_SIZE;
-			continue;
+	// Allocate the record index, large enough for every record.
+	unsigned int *records = NULL;
+	unsigned char *types = NULL;
+	unsigned int nrecords = 0;
+	unsigned int maxrecords = (size - headersize) / RECORD_SIZE;
+	if (maxrecords) {
+		records = (unsigned int *) dc_context_alloc (abstract->context, maxrecords * sizeof (unsigned int));
+		types = (unsigned char *) dc_context_alloc (abstract->context, maxrecords);
+		if (records == NULL || types == NULL) {
+			ERROR (abstract->context, "Failed to allocate memory.");
+			status = DC_STATUS_NOMEMORY;
+			goto error_free;
 		}
+	}
+
+	if (parser->tolerant) {
+		status = divesoft_freedom_scan (parser, headersize, records, types, &nrecords);
+		if (status != DC_STATUS_SUCCESS)
+			goto error_free;
+	} else {
+		// Classify all records upfront, and drop the empty ones. The types
+		// are compacted in place, along with the offsets.
+		divesoft_freedom_classify (data + headersize, maxrecords, types);
+		for (unsigned int i = 0; i < maxrecords; ++i) {
+			if (types[i] == RECORD_EMPTY) {
+				WARNING (abstract->context, "Skipping empty sample.");
+				continue;
+			}
+			records[nrecords] = headersize + i * RECORD_SIZE;
+			types[nrecords] = types[i];
+			nrecords++;
+		}
+
+		unsigned int tail = headersize + maxrecords * RECORD_SIZE;
+		if (tail < size) {
+			status = divesoft_freedom_skip (parser, tail, size - tail, DIVESOFT_FREEDOM_SKIP_TRUNCATED);
+			if (status != DC_STATUS_SUCCESS)
+				goto error_free;
+		}
+	}
+
+	// Parse the dive profile. The (dominant) point records carry nothing
+	// for the cache, and are skipped without looking at the data. In
+	// tolerant mode, the records that can't be used are marked as empty,
+	// and dropped afterwards.
+	unsigned int nrejected = 0;
+	for (unsigned int n = 0; n < nrecords; ++n) {
+		unsigned int type = types[n];
+		if ((CACHE_RECORDS & (1u << type)) == 0)
+			continue;
 
+		unsigned int offset = records[n];
 		unsigned int flags = array_uint32_le (data + offset);
-		unsigned int type      = (flags & 0x0000000F) >> 0;
-		unsigned int id        = (flags & 0x7FE00000) >> 21;
+		unsigned int id    = (flags & 0x7FE00000) >> 21;
+		unsigned int reject = 0;
 
 		if (type == LREC_CONFIGURATION) {
 			// Configuration record.
@@ -451,7 +952,9 @@ divesoft_freedom_cache (divesoft_freedom_parser_t *parser)
 					if (state & 0x01) {
 						if (ngasmix_diluent >= NGASMIXES) {
 							ERROR (abstract->context, "Maximum number of gas mixes reached.");
-							return DC_STATUS_NOMEMORY;
+							status = DC_STATUS_NOMEMORY;
+							reject = DIVESOFT_FREEDOM_SKIP_GASMIX;
+							break;
 						}
 						gasmix_diluent[ngasmix_diluent].oxygen = o2;
 						gasmix_diluent[ngasmix_diluent].helium = he;
@@ -483,32 +986,37 @@ divesoft_freedom_cache (divesoft_freedom_parser_t *parser)
 				}
 				gasmixid_previous = gasmixid;
 
-				// Add the gas mix.
+				// Add the gas mix and the tank. Both limits are checked
+				// first, to skip the record as a whole in tolerant mode.
 				if (ngasmix_ai >= NGASMIXES) {
 					ERROR (abstract->context, "Maximum number of gas mixes reached.");
-					return DC_STATUS_NOMEMORY;
-				}
-				gasmix_ai[ngasmix_ai].oxygen = o2;
-				gasmix_ai[ngasmix_ai].helium = he;
-				if (gasmixid == 10) {
-					gasmix_ai[ngasmix_ai].type = OXYGEN;
-				} else if (gasmixid == 11) {
-					gasmix_ai[ngasmix_ai].type = DILUENT;
-				} else {
-					gasmix_ai[ngasmix_ai].type = OC;
-				}
-				gasmix_ai[ngasmix_ai].id = gasmixid;
-				ngasmix_ai++;
-
-				// Add the tank.
-				if (ntanks >= NTANKS) {
+					status = DC_STATUS_NOMEMORY;
+					reject = DIVESOFT_FREEDOM_SKIP_GASMIX;
+				} else if (ntanks >= NTANKS) {
 					ERROR (abstract->context, "Maximum number of tanks reached.");
-					return DC_STATUS_NOMEMORY;
+					status = DC_STATUS_NOMEMORY;
+					reject = DIVESOFT_FREEDOM_SKIP_TANK;
+				} else {
+					gasmix_ai[ngasmix_ai].oxygen = o2;
+					gasmix_ai[ngasmix_ai].helium = he;
+					if (gasmixid == 10) {
+						gasmix_ai[ngasmix_ai].type = OXYGEN;
+					} else if (gasmixid == 11) {
+						gasmix_ai[ngasmix_ai].type = DILUENT;
+					} else {
+						gasmix_ai[ngasmix_ai].type = OC;
+					}
+					gasmix_ai[ngasmix_ai].id = gasmixid;
+					ngasmix_ai++;
+
+					tank[ntanks].volume = volume;
+					tank[ntanks].workpressure = workpressure;
+					tank[ntanks].transmitter = transmitter;
+					if (transmitter < NTANKS && tankmap[transmitter] == TANKMAP_NONE) {
+						tankmap[transmitter] = ntanks;
+					}
+					ntanks++;
 				}
-				tank[ntanks].volume = volume;
-				tank[ntanks].workpressure = workpressure;
-				tank[ntanks].transmitter = transmitter;
-				ntanks++;
 			}
 		} else if ((type >= LREC_MANIPULATION && type <= LREC_ACTIVITY) || type == LREC_INFO) {
 			// Event record.
@@ -528,11 +1036,11 @@ divesoft_freedom_cache (divesoft_freedom_parser_t *parser)
 				}
 
 				unsigned int idx = divesoft_freedom_find_gasmix (gasmix_event, ngasmix_event, o2, he, mixtype);
-				if (idx >= ngasmix_event) {
-					if (ngasmix_event >= NGASMIXES) {
-						ERROR (abstract->context, "Maximum number of gas mixes reached.");
-						return DC_STATUS_NOMEMORY;
-					}
+				if (idx >= ngasmix_event && ngasmix_event >= NGASMIXES) {
+					ERROR (abstract->context, "Maximum number of gas mixes reached.");
+					status = DC_STATUS_NOMEMORY;
+					reject = DIVESOFT_FREEDOM_SKIP_GASMIX;
+				} else if (idx >= ngasmix_event) {
 					gasmix_event[ngasmix_event].oxygen = o2;
 					gasmix_event[ngasmix_event].helium = he;
 					gasmix_event[ngasmix_event].type = mixtype;
@@ -548,10 +1056,12 @@ divesoft_freedom_cache (divesoft_freedom_parser_t *parser)
 					if (pressure == 0 || pressure == 0xFF)
 						continue;
 
-					unsigned int idx = divesoft_freedom_find_tank (tank, ntanks, i);
+					unsigned int idx = tankmap[i];
 					if (idx >= ntanks) {
-						ERROR (abstract->context, "Tank %u not found.", idx);
-						return DC_STATUS_DATAFORMAT;
+						ERROR (abstract->context, "Tank %u not found.", i);
+						status = DC_STATUS_DATAFORMAT;
+						reject = DIVESOFT_FREEDOM_SKIP_TANK;
+						break;
 					}
 
 					if (!tank[idx].active) {
@@ -572,7 +1082,42 @@ divesoft_freedom_cache (divesoft_freedom_parser_t *parser)
 			}
 		}
 
-		offset += RECORD_SIZE;
+		if (reject) {
+			if (!parser->tolerant)
+				goto error_free;
+
+			status = divesoft_freedom_skip (parser, offset, RECORD_SIZE, reject);
+			if (status != DC_STATUS_SUCCESS)
+				goto error_free;
+
+			types[n] = RECORD_EMPTY;
+			nrejected++;
+		}
+	}
+
+	if (nrejected) {
+		// Drop the rejected records.
+		unsigned int count = 0;
+		for (unsigned int n = 0; n < nrecords; ++n) {
+			if (types[n] == RECORD_EMPTY)
+				continue;
+			records[count] = records[n];
+			types[count] = types[n];
+			count++;
+		}
+		nrecords = count;
+
+		// Put their ranges in the order of the data, among the ranges of
+		// the scan. There are only a few, so an insertion sort will do.
+		for (unsigned int i = 1; i < parser->nranges; ++i) {
+			divesoft_freedom_range_t range = parser->ranges[i];
+			unsigned int j = i;
+			while (j > 0 && parser->ranges[j - 1].offset > range.offset) {
+				parser->ranges[j] = parser->ranges[j - 1];
+				j--;
+			}
+			parser->ranges[j] = range;
+		}
 	}
 
 	unsigned int ngasmixes = 0;
@@ -592,7 +1137,11 @@ divesoft_freedom_cache (divesoft_freedom_parser_t *parser)
 		if (idx >= ngasmixes) {
 			if (ngasmixes >= NGASMIXES) {
 				ERROR (abstract->context, "Maximum number of gas mixes reached.");
-				return DC_STATUS_NOMEMORY;
+				if (!parser->tolerant) {
+					status = DC_STATUS_NOMEMORY;
+					goto error_free;
+				}
+				continue;
 			}
 			gasmix[ngasmixes] = gasmix_diluent[i];
 			ngasmixes++;
@@ -604,11 +1153,14 @@ divesoft_freedom_cache (divesoft_freedom_parser_t *parser)
 		(diluent_o2 != 0 || diluent_he != 0)) {
 		unsigned int idx = divesoft_freedom_find_gasmix (gasmix, ngasmixes,
 			diluent_o2, diluent_he, DILUENT);
-		if (idx >= ngasmixes) {
-			if (ngasmixes >= NGASMIXES) {
-				ERROR (abstract->context, "Maximum number of gas mixes reached.");
-				return DC_STATUS_NOMEMORY;
+		if (idx >= ngasmixes && ngasmixes >= NGASMIXES) {
+			ERROR (abstract->context, "Maximum number of gas mixes reached.");
+			if (!parser->tolerant) {
+				status = DC_STATUS_NOMEMORY;
+				goto error_free;
 			}
+			idx = UNDEFINED;
+		} else if (idx >= ngasmixes) {
 			gasmix[ngasmixes].oxygen = diluent_o2;
 			gasmix[ngasmixes].helium = diluent_he;
 			gasmix[ngasmixes].type = DILUENT;
@@ -627,7 +1179,11 @@ divesoft_freedom_cache (divesoft_freedom_parser_t *parser)
 		if (idx >= ngasmixes) {
 			if (ngasmixes >= NGASMIXES) {
 				ERROR (abstract->context, "Maximum number of gas mixes reached.");
-				return DC_STATUS_NOMEMORY;
+				if (!parser->tolerant) {
+					status = DC_STATUS_NOMEMORY;
+					goto error_free;
+				}
+				continue;
 			}
 			gasmix[ngasmixes] = gasmix_event[i];
 			ngasmixes++;
@@ -636,14 +1192,6 @@ divesoft_freedom_cache (divesoft_freedom_parser_t *parser)
 
 	// Cache the data for later use.
 	parser->cached = 1;
-	parser->version = version;
-	parser->headersize = headersize;
-	parser->divetime = divetime;
-	parser->divemode = divemode;
-	parser->temperature_min = temperature_min;
-	parser->maxdepth = maxdepth;
-	parser->atmospheric = atmospheric;
-	parser->avgdepth = avgdepth;
 	parser->ngasmixes = ngasmixes;
 	for (unsigned int i = 0; i < ngasmixes; ++i) {
 		parser->gasmix[i] = gasmix[i];
@@ -653,6 +1201,8 @@ divesoft_freedom_cache (divesoft_freedom_parser_t *parser)
 	for (unsigned int i = 0; i < ntanks; ++i) {
 		parser->tank[i] = tank[i];
 	}
+	memcpy (parser->tankmap, tankmap, sizeof (tankmap));
+	divesoft_freedom_map_gasmixes (parser->gasmap, gasmix, ngasmixes);
 	parser->vpm = vpm;
 	parser->gf_lo = gf_lo;
 	parser->gf_hi = gf_hi;
@@ -664,8 +1214,16 @@ divesoft_freedom_cache (divesoft_freedom_parser_t *parser)
 	parser->have_location = have_location;
 	parser->latitude = latitude;
 	parser->longitude = longitude;
+	parser->records = records;
+	parser->types = types;
+	parser->nrecords = nrecords;
 
 	return DC_STATUS_SUCCESS;
+
+error_free:
+	dc_context_release (abstract->context, records);
+	dc_context_release (abstract->context, types);
+	return status;
 }
 
 dc_status_t
@@ -684,8 +1242,9 @@ divesoft_freedom_parser_create (dc_parser_t **out, dc_context_t *context, const
 	}
 
 	// Set the default values.
+	parser->header_cached = 0;
 	parser->cached = 0;
-	parser->version = 0;
+	parser->layout = NULL;
 	parser->headersize = 0;
 	parser->divetime = 0;
 	parser->divemode = 0;
@@ -710,6 +1269,8 @@ divesoft_freedom_parser_create (dc_parser_t **out, dc_context_t *context, const
 		parser->tank[i].transmitter = 0;
 		parser->tank[i].active = 0;
 	}
+	memset (parser->tankmap, TANKMAP_NONE, sizeof (parser->tankmap));
+	memset (parser->gasmap, 0, sizeof (parser->gasmap));
 	parser->vpm = 0;
 	parser->gf_lo = 0;
 	parser->gf_hi = 0;
@@ -721,58 +1282,228 @@ divesoft_freedom_parser_create (dc_parser_t **out, dc_context_t *context, const
 	parser->have_location = 0;
 	parser->latitude = 0;
 	parser->longitude = 0;
+	parser->records = NULL;
+	parser->types = NULL;
+	parser->nrecords = 0;
+	parser->indexed = 0;
+	parser->times = NULL;
+	parser->bytype = NULL;
+	parser->tissues_cached = 0;
+	parser->tissues = NULL;
+	parser->ntissues = 0;
+	parser->tolerant = 0;
+	parser->incremental = 0;
+	parser->ranges = NULL;
+	parser->nranges = 0;
+	parser->maxranges = 0;
+	for (unsigned int i = 0; i <= RECORD_TYPES; ++i) {
+		parser->typestart[i] = 0;
+	}
 
 	*out = (dc_parser_t *) parser;
 
 	return DC_STATUS_SUCCESS;
 }
 
-static dc_status_t
-divesoft_freedom_parser_get_datetime (dc_parser_t *abstract, dc_datetime_t *datetime)
+/*
+ * Discard the cached data, to parse the dive again.
+ */
+static void
+divesoft_freedom_invalidate (divesoft_freedom_parser_t *parser)
 {
-	dc_status_t status = DC_STATUS_SUCCESS;
-	divesoft_freedom_parser_t *parser = (divesoft_freedom_parser_t *) abstract;
-	const unsigned char *data = abstract->data;
+	dc_context_t *context = parser->base.context;
 
-	// Cache the header data.
-	status = divesoft_freedom_cache (parser);
-	if (status != DC_STATUS_SUCCESS)
-		return status;
+	dc_context_release (context, parser->records);
+	dc_context_release (context, parser->types);
+	dc_context_release (context, parser->times);
+	dc_context_release (context, parser->bytype);
+	dc_context_release (context, parser->tissues);
 
-	unsigned int timestamp = array_uint32_le (data + 8);
+	parser->header_cached = 0;
+	parser->cached = 0;
+	parser->records = NULL;
+	parser->types = NULL;
+	parser->nrecords = 0;
+	parser->indexed = 0;
+	parser->times = NULL;
+	parser->bytype = NULL;
+	parser->tissues_cached = 0;
+	parser->tissues = NULL;
+	parser->ntissues = 0;
+	parser->nranges = 0;
+}
 
-	int timezone = 0;
-	if (parser->version == HEADER_SIGNATURE_V2) {
-		timezone = ((signed short) array_uint16_le (data + 40)) * 60;
-	} else {
-		timezone = 0;
-	}
+static dc_status_t
+divesoft_freedom_parser_destroy (dc_parser_t *abstract)
+{
+	divesoft_freedom_parser_t *parser = (divesoft_freedom_parser_t *) abstract;
 
-	dc_ticks_t ticks = (dc_ticks_t) timestamp + EPOCH + timezone;
+	divesoft_freedom_invalidate (parser);
+	dc_context_release (abstract->context, parser->ranges);
 
-	if (!dc_datetime_gmtime (datetime, ticks))
-		return DC_STATUS_DATAFORMAT;
+	return DC_STATUS_SUCCESS;
+}
 
-	if (parser->version == HEADER_SIGNATURE_V2) {
-		datetime->timezone = timezone;
-	} else {
-		datetime->timezone = DC_TIMEZONE_NONE;
+static dc_status_t
+divesoft_freedom_parser_reset (dc_parser_t *abstract)
+{
+	divesoft_freedom_parser_t *parser = (divesoft_freedom_parser_t *) abstract;
+
+	// Everything derived from the data is recomputed by the cache. The
+	// range list keeps its memory for the next dive.
+	divesoft_freedom_invalidate (parser);
+
+	return DC_STATUS_SUCCESS;
+}
+
+dc_status_t
+divesoft_freedom_parser_set_tolerant (dc_parser_t *abstract, unsigned int tolerant)
+{
+	divesoft_freedom_parser_t *parser = (divesoft_freedom_parser_t *) abstract;
+
+	if (!ISINSTANCE (abstract))
+		return DC_STATUS_INVALIDARGS;
+
+	tolerant = tolerant ? 1 : 0;
+	if (parser->tolerant != tolerant) {
+		divesoft_freedom_invalidate (parser);
+		parser->tolerant = tolerant;
+		abstract->sample_rewind = 1;
 	}
 
 	return DC_STATUS_SUCCESS;
 }
 
+dc_status_t
+divesoft_freedom_parser_get_diagnostics (dc_parser_t *abstract, divesoft_freedom_diagnostics_t *diagnostics)
+{
+	dc_status_t status = DC_STATUS_SUCCESS;
+	divesoft_freedom_parser_t *parser = (divesoft_freedom_parser_t *) abstract;
+
+	if (!ISINSTANCE (abstract) || diagnostics == NULL)
+		return DC_STATUS_INVALIDARGS;
+
+	status = divesoft_freedom_cache (parser);
+	if (status != DC_STATUS_SUCCESS)
+		return status;
+
+	unsigned int skipped = 0;
+	for (unsigned int i = 0; i < parser->nranges; ++i) {
+		skipped += parser->ranges[i].size;
+	}
+
+	diagnostics->nrecords = parser->nrecords;
+	diagnostics->skipped = skipped;
+	diagnostics->nranges = parser->nranges;
+	diagnostics->ranges = parser->ranges;
+
+	return DC_STATUS_SUCCESS;
+}
+
+dc_status_t
+divesoft_freedom_parser_validate (dc_parser_t *abstract)
+{
+	dc_status_t status = DC_STATUS_SUCCESS;
+	divesoft_freedom_parser_t *parser = (divesoft_freedom_parser_t *) abstract;
+	const unsigned char *data = abstract->data;
+	unsigned int size = abstract->size;
+
+	if (!ISINSTANCE (abstract))
+		return DC_STATUS_INVALIDARGS;
+
+	const divesoft_freedom_layout_t *layout = NULL;
+	status = divesoft_freedom_check_header (abstract->context, data, size, &layout);
+	if (status != DC_STATUS_SUCCESS)
+		return status;
+
+	// Check the order of the timestamps, with the same tolerance as the
+	// sample decoding. Only the first word of every record is needed. In
+	// tolerant mode, records out of order are skipped.
+	if (!parser->tolerant) {
+		unsigned int time = UNDEFINED;
+		for (unsigned int offset = layout->headersize; offset + RECORD_SIZE <= size; offset += RECORD_SIZE) {
+			unsigned int flags = array_uint32_le (data + offset);
+			if (flags == 0xFFFFFFFF && array_isequal (data + offset, RECORD_SIZE, 0xFF))
+				continue;
+
+			unsigned int timestamp = (flags & 0x001FFFF0) >> 4;
+			if (timestamp < time && time != UNDEFINED) {
+				if (time - timestamp > 5) {
+					ERROR (abstract->context, "Timestamp moved backwards (%u %u).", timestamp, time);
+					return DC_STATUS_DATAFORMAT;
+				}
+				continue;
+			}
+			time = timestamp;
+		}
+	}
+
+	// The references to the gas mixes and tanks are checked by the cache,
+	// which skips the point records without decoding them. The result is
+	// kept, so the fields and samples don't scan the profile again.
+	return divesoft_freedom_cache (parser);
+}
+
 static dc_status_t
-divesoft_freedom_parser_get_field (dc_parser_t *abstract, dc_field_type_t type, unsigned int flags, void *value)
+divesoft_freedom_parser_get_datetime (dc_parser_t *abstract, dc_datetime_t *datetime)
 {
 	dc_status_t status = DC_STATUS_SUCCESS;
 	divesoft_freedom_parser_t *parser = (divesoft_freedom_parser_t *) abstract;
+	const unsigned char *data = abstract->data;
 
 	// Cache the header data.
-	status = divesoft_freedom_cache (parser);
+	status = divesoft_freedom_cache_header (parser);
 	if (status != DC_STATUS_SUCCESS)
 		return status;
 
+	unsigned int timestamp = array_uint32_le (data + 8);
+
+	int timezone = 0;
+	if (parser->layout->timezone) {
+		timezone = ((signed short) array_uint16_le (data + parser->layout->timezone)) * 60;
+	}
+
+	dc_ticks_t ticks = (dc_ticks_t) timestamp + EPOCH + timezone;
+
+	if (!dc_datetime_gmtime (datetime, ticks))
+		return DC_STATUS_DATAFORMAT;
+
+	if (parser->layout->timezone) {
+		datetime->timezone = timezone;
+	} else {
+		datetime->timezone = DC_TIMEZONE_NONE;
+	}
+
+	return DC_STATUS_SUCCESS;
+}
+
+/*
+ * Check whether a field is stored in the dive header.
+ */
+static int
+divesoft_freedom_is_header_field (dc_field_type_t type)
+{
+	switch (type) {
+	case DC_FIELD_DIVETIME:
+	case DC_FIELD_MAXDEPTH:
+	case DC_FIELD_AVGDEPTH:
+	case DC_FIELD_TEMPERATURE_MINIMUM:
+	case DC_FIELD_ATMOSPHERIC:
+	case DC_FIELD_DIVEMODE:
+		return 1;
+	default:
+		return 0;
+	}
+}
+
+/*
+ * Get a field from the cached data.
+ */
+static dc_status_t
+divesoft_freedom_parser_cached_field (dc_parser_t *abstract, dc_field_type_t type, unsigned int flags, void *value)
+{
+	divesoft_freedom_parser_t *parser = (divesoft_freedom_parser_t *) abstract;
+
 	dc_salinity_t *water = (dc_salinity_t *) value;
 	dc_gasmix_t *gasmix = (dc_gasmix_t *) value;
 	dc_tank_t *tank = (dc_tank_t *) value;
@@ -788,7 +1519,7 @@ divesoft_freedom_parser_get_field (dc_parser_t *abstract, dc_field_type_t type,
 			*((double *) value) = parser->maxdepth / 100.0;
 			break;
 		case DC_FIELD_AVGDEPTH:
-			if (parser->version != HEADER_SIGNATURE_V2)
+			if (parser->layout->avgdepth.size == 0 || parser->avgdepth == 0xFFFF)
 				return DC_STATUS_UNSUPPORTED;
 			*((double *) value) = parser->avgdepth / 100.0;
 			break;
@@ -888,196 +1619,973 @@ divesoft_freedom_parser_get_field (dc_parser_t *abstract, dc_field_type_t type,
 	return DC_STATUS_SUCCESS;
 }
 
+/*
+ * Get a field from the cached header data only.
+ */
 static dc_status_t
-divesoft_freedom_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callback_t callback, void *userdata)
+divesoft_freedom_parser_header_field (dc_parser_t *abstract, dc_field_type_t type, unsigned int flags, void *value)
+{
+	if (!divesoft_freedom_is_header_field (type))
+		return DC_STATUS_UNSUPPORTED;
+
+	return divesoft_freedom_parser_cached_field (abstract, type, flags, value);
+}
+
+static dc_status_t
+divesoft_freedom_parser_get_field (dc_parser_t *abstract, dc_field_type_t type, unsigned int flags, void *value)
 {
 	dc_status_t status = DC_STATUS_SUCCESS;
 	divesoft_freedom_parser_t *parser = (divesoft_freedom_parser_t *) abstract;
-	const unsigned char *data = abstract->data;
-	unsigned int size = abstract->size;
 
-	// Cache the header data.
-	status = divesoft_freedom_cache (parser);
+	// The fields of the dive header don't need the profile.
+	if (divesoft_freedom_is_header_field (type)) {
+		status = divesoft_freedom_cache_header (parser);
+	} else {
+		status = divesoft_freedom_cache (parser);
+	}
 	if (status != DC_STATUS_SUCCESS)
 		return status;
 
-	unsigned int time = UNDEFINED;
-	unsigned int initial = 0;
-	unsigned int offset = parser->headersize;
-	while (offset + RECORD_SIZE <= size) {
-		dc_sample_value_t sample = {0};
+	return divesoft_freedom_parser_cached_field (abstract, type, flags, value);
+}
 
-		if (array_isequal(data + offset, RECORD_SIZE, 0xFF)) {
-			WARNING (abstract->context, "Skipping empty sample.");
-			offset += RECORD_SIZE;
-			continue;
+static dc_status_t
+divesoft_freedom_parser_get_summary (dc_parser_t *abstract, dc_summary_t *summary)
+{
+	dc_status_t status = DC_STATUS_SUCCESS;
+	divesoft_freedom_parser_t *parser = (divesoft_freedom_parser_t *) abstract;
+
+	// Cache the data, once for all the fields.
+	status = divesoft_freedom_cache_header (parser);
+	if (status != DC_STATUS_SUCCESS)
+		return status;
+
+	// If the profile can't be used, the header fields are still filled
+	// in, and the error is returned afterwards.
+	status = divesoft_freedom_cache (parser);
+	if (status != DC_STATUS_SUCCESS) {
+		dc_parser_fill_summary (abstract, divesoft_freedom_parser_header_field, summary);
+		return status;
+	}
+
+	return dc_parser_fill_summary (abstract, divesoft_freedom_parser_cached_field, summary);
+}
+
+/*
+ * Find the first record in the list (positions into the record index,
+ * or the record index itself if NULL) with a timestamp of at least the
+ * given value.
+ */
+static unsigned int
+divesoft_freedom_lower_bound (const unsigned int times[], const unsigned int positions[], unsigned int lo, unsigned int hi, unsigned int value)
+{
+	while (lo < hi) {
+		unsigned int mid = lo + (hi - lo) / 2;
+		unsigned int pos = positions ? positions[mid] : mid;
+		if (times[pos] < value) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
 		}
+	}
 
-		unsigned int flags = array_uint32_le (data + offset);
-		unsigned int type      = (flags & 0x0000000F) >> 0;
-		unsigned int timestamp = (flags & 0x001FFFF0) >> 4;
-		unsigned int id        = (flags & 0x7FE00000) >> 21;
+	return lo;
+}
 
-		if (timestamp != time) {
-			if (timestamp < time && time != UNDEFINED) {
-				// The timestamp are supposed to be monotonically increasing,
-				// but occasionally there are small jumps back in time with just
-				// 1 or 2 seconds. To get back in sync, those samples are
-				// skipped. Larger jumps are treated as errors.
-				if (time - timestamp > 5) {
-					ERROR (abstract->context, "Timestamp moved backwards (%u %u).", timestamp, time);
-					return DC_STATUS_DATAFORMAT;
-				}
-				WARNING (abstract->context, "Timestamp moved backwards (%u %u).", timestamp, time);
-				offset += RECORD_SIZE;
-				continue;
-			}
-			time = timestamp;
-			sample.time = time * 1000;
-			if (callback) callback(DC_SAMPLE_TIME, &sample, userdata);
+/*
+ * Start the sample decoding at the first record, or at the start of the
+ * time window of the sample filter.
+ */
+static dc_status_t
+divesoft_freedom_cursor_init (divesoft_freedom_parser_t *parser, divesoft_freedom_cursor_t *cursor)
+{
+	dc_status_t status = DC_STATUS_SUCCESS;
+	dc_parser_t *abstract = (dc_parser_t *) parser;
+
+	// Cache the header data. This also indexes the profile records, with
+	// the empty records already left out.
+	status = divesoft_freedom_cache (parser);
+	if (status != DC_STATUS_SUCCESS)
+		return status;
+
+	cursor->position = 0;
+	cursor->time = UNDEFINED;
+	cursor->initial = 0;
+
+	// Seek to the start of the time window. Everything before it would
+	// be filtered out anyway, including the initial diluent.
+	if (abstract->sample_begin) {
+		status = divesoft_freedom_parser_index (abstract);
+		if (status != DC_STATUS_SUCCESS)
+			return status;
+
+		unsigned int begin = abstract->sample_begin / 1000 + (abstract->sample_begin % 1000 != 0);
+		cursor->position = divesoft_freedom_lower_bound (parser->times, NULL, 0, parser->nrecords, begin);
+		if (cursor->position) {
+			cursor->time = parser->times[cursor->position - 1];
+			cursor->initial = 1;
 		}
+	}
+
+	return DC_STATUS_SUCCESS;
+}
+
+static dc_sample_value_t *
+divesoft_freedom_sample (dc_sample_t samples[], unsigned int *count, dc_sample_type_t type)
+{
+	dc_sample_t *sample = &samples[(*count)++];
+	sample->type = type;
+	return &sample->value;
+}
 
-		// Initial diluent.
-		if (!initial) {
-			if (parser->diluent != UNDEFINED) {
-				sample.gasmix = parser->diluent;
-				if (callback) callback(DC_SAMPLE_GASMIX, &sample, userdata);
+/*
+ * Decode the record at the cursor into at most MAXSAMPLES samples, and
+ * advance the cursor. On error, the count holds the samples decoded
+ * before the error.
+ */
+static dc_status_t
+divesoft_freedom_decode_record (divesoft_freedom_parser_t *parser, divesoft_freedom_cursor_t *cursor, dc_sample_t samples[], unsigned int *count)
+{
+	dc_parser_t *abstract = (dc_parser_t *) parser;
+	const unsigned char *data = abstract->data;
+
+	dc_sample_value_t *sample = NULL;
+	unsigned int type = parser->types[cursor->position];
+	unsigned int offset = parser->records[cursor->position++];
+
+	unsigned int flags = array_uint32_le (data + offset);
+	unsigned int timestamp = (flags & 0x001FFFF0) >> 4;
+	unsigned int id        = (flags & 0x7FE00000) >> 21;
+
+	*count = 0;
+
+	if (timestamp != cursor->time) {
+		if (timestamp < cursor->time && cursor->time != UNDEFINED) {
+			// The timestamp are supposed to be monotonically increasing,
+			// but occasionally there are small jumps back in time with just
+			// 1 or 2 seconds. To get back in sync, those samples are
+			// skipped. Larger jumps are treated as errors.
+			if (cursor->time - timestamp > 5) {
+				ERROR (abstract->context, "Timestamp moved backwards (%u %u).", timestamp, cursor->time);
+				return DC_STATUS_DATAFORMAT;
 			}
-			initial = 1;
+			WARNING (abstract->context, "Timestamp moved backwards (%u %u).", timestamp, cursor->time);
+			return DC_STATUS_SUCCESS;
+		}
+		if (timestamp * 1000 >= abstract->sample_end) {
+			cursor->position = parser->nrecords;
+			return DC_STATUS_SUCCESS;
 		}
+		cursor->time = timestamp;
+		sample = divesoft_freedom_sample (samples, count, DC_SAMPLE_TIME);
+		sample->time = timestamp * 1000;
+	}
 
-		if (type == LREC_POINT) {
-			// General log record.
-			unsigned int depth = array_uint16_le (data + offset + 4);
-			unsigned int ppo2  = array_uint16_le (data + offset + 6);
+	// Initial diluent.
+	if (!cursor->initial) {
+		if (parser->diluent != UNDEFINED && DC_PARSER_WANTS (abstract, DC_SAMPLE_MASK (DC_SAMPLE_GASMIX))) {
+			sample = divesoft_freedom_sample (samples, count, DC_SAMPLE_GASMIX);
+			sample->gasmix = parser->diluent;
+		}
+		cursor->initial = 1;
+	}
 
-			sample.depth = depth / 100.0;
-			if (callback) callback(DC_SAMPLE_DEPTH, &sample, userdata);
+	if (type == LREC_POINT) {
+		// General log record.
+		unsigned int depth = array_uint16_le (data + offset + 4);
+		unsigned int ppo2  = array_uint16_le (data + offset + 6);
 
-			if (ppo2) {
-				sample.ppo2.sensor = DC_SENSOR_NONE;
-				sample.ppo2.value = ppo2 * 10.0 / BAR;
-				if (callback) callback(DC_SAMPLE_PPO2, &sample, userdata);
-			}
+		sample = divesoft_freedom_sample (samples, count, DC_SAMPLE_DEPTH);
+		sample->depth = depth / 100.0;
 
-			if (id == POINT_2) {
-				unsigned int orientation = array_uint32_le (data + offset + 8);
-				unsigned int heading = orientation & 0x1FF;
-				sample.bearing = heading;
-				if (callback) callback (DC_SAMPLE_BEARING, &sample, userdata);
-			} else if (id == POINT_1 || id == POINT_1_OLD) {
-				unsigned int misc = array_uint32_le (data + offset + 8);
-				unsigned int ceiling = array_uint16_le (data + offset + 12);
-				unsigned int setpoint = data[offset + 15];
-				unsigned int ndl  = (misc & 0x000003FF);
-				unsigned int tts  = (misc & 0x000FFC00) >> 10;
-				unsigned int temp = (misc & 0x3FF00000) >> 20;
-
-				// Temperature
-				sample.temperature = (signed int) signextend (temp, 10) / 10.0;
-				if (callback) callback(DC_SAMPLE_TEMPERATURE, &sample, userdata);
-
-				// Deco / NDL
-				if (ceiling) {
-					sample.deco.type = DC_DECO_DECOSTOP;
-					sample.deco.time = 0;
-					sample.deco.depth = ceiling / 100.0;
-				} else {
-					sample.deco.type = DC_DECO_NDL;
-					sample.deco.time = ndl * 60;
-					sample.deco.depth = 0.0;
-				}
-				sample.deco.tts = tts * 60;
-				if (callback) callback(DC_SAMPLE_DECO, &sample, userdata);
+		if (ppo2 && DC_PARSER_WANTS (abstract, DC_SAMPLE_MASK (DC_SAMPLE_PPO2))) {
+			sample = divesoft_freedom_sample (samples, count, DC_SAMPLE_PPO2);
+			sample->ppo2.sensor = DC_SENSOR_NONE;
+			sample->ppo2.value = ppo2 * 10.0 / BAR;
+		}
 
-				// Setpoint
-				if (setpoint) {
-					sample.setpoint = setpoint / 100.0;
-					if (callback) callback(DC_SAMPLE_SETPOINT, &sample, userdata);
-				}
+		if (!DC_PARSER_WANTS (abstract, DC_SAMPLE_MASK (DC_SAMPLE_BEARING) |
+			DC_SAMPLE_MASK (DC_SAMPLE_TEMPERATURE) | DC_SAMPLE_MASK (DC_SAMPLE_DECO) |
+			DC_SAMPLE_MASK (DC_SAMPLE_SETPOINT))) {
+			// Nothing else is needed from this record.
+		} else if (id == POINT_2) {
+			unsigned int orientation = array_uint32_le (data + offset + 8);
+			unsigned int heading = orientation & 0x1FF;
+			sample = divesoft_freedom_sample (samples, count, DC_SAMPLE_BEARING);
+			sample->bearing = heading;
+		} else if (id == POINT_1 || id == POINT_1_OLD) {
+			unsigned int misc = array_uint32_le (data + offset + 8);
+			unsigned int ceiling = array_uint16_le (data + offset + 12);
+			unsigned int setpoint = data[offset + 15];
+			unsigned int ndl  = (misc & 0x000003FF);
+			unsigned int tts  = (misc & 0x000FFC00) >> 10;
+			unsigned int temp = (misc & 0x3FF00000) >> 20;
+
+			// Temperature
+			sample = divesoft_freedom_sample (samples, count, DC_SAMPLE_TEMPERATURE);
+			sample->temperature = (signed int) signextend (temp, 10) / 10.0;
+
+			// Deco / NDL
+			sample = divesoft_freedom_sample (samples, count, DC_SAMPLE_DECO);
+			if (ceiling) {
+				sample->deco.type = DC_DECO_DECOSTOP;
+				sample->deco.time = 0;
+				sample->deco.depth = ceiling / 100.0;
+			} else {
+				sample->deco.type = DC_DECO_NDL;
+				sample->deco.time = ndl * 60;
+				sample->deco.depth = 0.0;
 			}
-		} else if ((type >= LREC_MANIPULATION && type <= LREC_ACTIVITY) || type == LREC_INFO) {
-			// Event record.
-			unsigned int event = array_uint16_le (data + offset + 4);
+			sample->deco.tts = tts * 60;
 
-			if (event == EVENT_BOOKMARK) {
-				sample.event.type = SAMPLE_EVENT_BOOKMARK;
-				sample.event.time = 0;
-				sample.event.flags = 0;
-				sample.event.value = 0;
-				if (callback) callback(DC_SAMPLE_EVENT, &sample, userdata);
-			} else if (event == EVENT_MIX_CHANGED || event == EVENT_DILUENT || event == EVENT_CHANGE_MODE) {
-				unsigned int o2 = data[offset + 6];
-				unsigned int he = data[offset + 7];
-				unsigned int mixtype = OC;
-				if (event == EVENT_DILUENT) {
+			// Setpoint
+			if (setpoint) {
+				sample = divesoft_freedom_sample (samples, count, DC_SAMPLE_SETPOINT);
+				sample->setpoint = setpoint / 100.0;
+			}
+		}
+	} else if ((type >= LREC_MANIPULATION && type <= LREC_ACTIVITY) || type == LREC_INFO) {
+		// Event record.
+		unsigned int event = array_uint16_le (data + offset + 4);
+
+		if (!DC_PARSER_WANTS (abstract, DC_SAMPLE_MASK (DC_SAMPLE_EVENT) |
+			DC_SAMPLE_MASK (DC_SAMPLE_GASMIX) | DC_SAMPLE_MASK (DC_SAMPLE_CNS) |
+			DC_SAMPLE_MASK (DC_SAMPLE_SETPOINT))) {
+			// Not needed.
+		} else if (event == EVENT_BOOKMARK) {
+			sample = divesoft_freedom_sample (samples, count, DC_SAMPLE_EVENT);
+			sample->event.type = SAMPLE_EVENT_BOOKMARK;
+			sample->event.time = 0;
+			sample->event.flags = 0;
+			sample->event.value = 0;
+		} else if (event == EVENT_MIX_CHANGED || event == EVENT_DILUENT || event == EVENT_CHANGE_MODE) {
+			unsigned int o2 = data[offset + 6];
+			unsigned int he = data[offset + 7];
+			unsigned int mixtype = OC;
+			if (event == EVENT_DILUENT) {
+				mixtype = DILUENT;
+			} else if (event == EVENT_CHANGE_MODE) {
+				unsigned int mode = data[offset + 8];
+				if (divesoft_freedom_is_ccr (mode)) {
 					mixtype = DILUENT;
-				} else if (event == EVENT_CHANGE_MODE) {
-					unsigned int mode = data[offset + 8];
-					if (divesoft_freedom_is_ccr (mode)) {
-						mixtype = DILUENT;
-					}
 				}
+			}
 
-				unsigned int idx = divesoft_freedom_find_gasmix (parser->gasmix, parser->ngasmixes, o2, he, mixtype);
-				if (idx >= parser->ngasmixes) {
-					ERROR (abstract->context, "Gas mix (%u/%u) not found.", o2, he);
+			unsigned int idx = divesoft_freedom_lookup_gasmix (parser->gasmap, parser->gasmix, parser->ngasmixes, o2, he, mixtype);
+			if (idx >= parser->ngasmixes && parser->incremental) {
+				idx = divesoft_freedom_add_gasmix (parser, o2, he, mixtype);
+			}
+			if (idx >= parser->ngasmixes) {
+				ERROR (abstract->context, "Gas mix (%u/%u) not found.", o2, he);
+				if (!parser->tolerant)
 					return DC_STATUS_DATAFORMAT;
+			} else {
+				sample = divesoft_freedom_sample (samples, count, DC_SAMPLE_GASMIX);
+				sample->gasmix = idx;
+			}
+		} else if (event == EVENT_CNS) {
+			sample = divesoft_freedom_sample (samples, count, DC_SAMPLE_CNS);
+			sample->cns = array_uint16_le (data + offset + 6) / 100.0;
+		} else if (event == EVENT_SETPOINT_MANUAL || event == EVENT_SETPOINT_AUTO) {
+			sample = divesoft_freedom_sample (samples, count, DC_SAMPLE_SETPOINT);
+			sample->setpoint = data[offset + 6] / 100.0;
+		}
+	} else if (type == LREC_MEASURE) {
+		// Measurement record.
+		if (id == MEASURE_ID_AI_PRESSURE && DC_PARSER_WANTS (abstract, DC_SAMPLE_MASK (DC_SAMPLE_PRESSURE))) {
+			for (unsigned int i = 0; i < NTANKS; ++i) {
+				unsigned int pressure = data[offset + 4 + i];
+				if (pressure == 0 || pressure == 0xFF)
+					continue;
+
+				unsigned int idx = parser->tankmap[i];
+				if (idx >= parser->ntanks) {
+					ERROR (abstract->context, "Tank %u not found.", i);
+					if (!parser->tolerant)
+						return DC_STATUS_DATAFORMAT;
+					continue;
 				}
-				sample.gasmix = idx;
-				if (callback) callback(DC_SAMPLE_GASMIX, &sample, userdata);
-			} else if (event == EVENT_CNS) {
-				sample.cns = array_uint16_le (data + offset + 6) / 100.0;
-				if (callback) callback(DC_SAMPLE_CNS, &sample, userdata);
-			} else if (event == EVENT_SETPOINT_MANUAL || event == EVENT_SETPOINT_AUTO) {
-				sample.setpoint = data[6] / 100.0;
-				if (callback) callback(DC_SAMPLE_SETPOINT, &sample, userdata);
+
+				sample = divesoft_freedom_sample (samples, count, DC_SAMPLE_PRESSURE);
+				sample->pressure.tank = idx;
+				sample->pressure.value = pressure * 2.0;
 			}
-		} else if (type == LREC_MEASURE) {
-			// Measurement record.
-			if (id == MEASURE_ID_AI_PRESSURE) {
-				for (unsigned int i = 0; i < NTANKS; ++i) {
-					unsigned int pressure = data[offset + 4 + i];
-					if (pressure == 0 || pressure == 0xFF)
-						continue;
+		} else if (id == MEASURE_ID_OXYGEN && DC_PARSER_WANTS (abstract, DC_SAMPLE_MASK (DC_SAMPLE_PPO2))) {
+			for (unsigned int i = 0; i < NSENSORS; ++i) {
+				unsigned int ppo2 = array_uint16_le (data + offset + 4 + i * 2);
+				if (ppo2 == 0 || ppo2 == 0xFFFF)
+					continue;
+				sample = divesoft_freedom_sample (samples, count, DC_SAMPLE_PPO2);
+				sample->ppo2.sensor = i;
+				sample->ppo2.value = ppo2 * 10.0 / BAR;
+			}
+		} else if (id == MEASURE_ID_OXYGEN_MV && DC_PARSER_WANTS (abstract, DC_SAMPLE_MASK (DC_SAMPLE_PPO2))) {
+			for (unsigned int i = 0; i < NSENSORS; ++i) {
+				unsigned int value = array_uint16_le (data + offset + 4 + i * 2);
+				unsigned int state = data[offset + 12 + i];
+				if (!parser->calibrated || parser->calibration[i] == 0 ||
+					state == SENSTAT_UNCALIBRATED || state == SENSTAT_NOT_EXIST)
+					continue;
+				sample = divesoft_freedom_sample (samples, count, DC_SAMPLE_PPO2);
+				sample->ppo2.sensor = i;
+				sample->ppo2.value = value / 100.0 * parser->calibration[i] / BAR;
+			}
+		}
+	} else if (type == LREC_STATE) {
+		// Tissue saturation record.
+	}
 
-					unsigned int idx = divesoft_freedom_find_tank (parser->tank, parser->ntanks, i);
-					if (idx >= parser->ntanks) {
-						ERROR (abstract->context, "Tank %u not found.", idx);
-						return DC_STATUS_DATAFORMAT;
-					}
+	return DC_STATUS_SUCCESS;
+}
 
-					sample.pressure.tank = idx;
-					sample.pressure.value = pressure * 2.0;
-					if (callback) callback(DC_SAMPLE_PRESSURE, &sample, userdata);
-				}
-			} else if (id == MEASURE_ID_OXYGEN) {
-				for (unsigned int i = 0; i < NSENSORS; ++i) {
-					unsigned int ppo2 = array_uint16_le (data + offset + 4 + i * 2);
-					if (ppo2 == 0 || ppo2 == 0xFFFF)
-						continue;
-					sample.ppo2.sensor = i;
-					sample.ppo2.value = ppo2 * 10.0 / BAR;
-					if (callback) callback(DC_SAMPLE_PPO2, &sample, userdata);
-				}
-			} else if (id == MEASURE_ID_OXYGEN_MV) {
-				for (unsigned int i = 0; i < NSENSORS; ++i) {
-					unsigned int value = array_uint16_le (data + offset + 4 + i * 2);
-					unsigned int state = data[offset + 12 + i];
-					if (!parser->calibrated || parser->calibration[i] == 0 ||
-						state == SENSTAT_UNCALIBRATED || state == SENSTAT_NOT_EXIST)
-						continue;
-					sample.ppo2.sensor = i;
-					sample.ppo2.value = value / 100.0 * parser->calibration[i] / BAR;
-					if (callback) callback(DC_SAMPLE_PPO2, &sample, userdata);
+static dc_status_t
+divesoft_freedom_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callback_t callback, void *userdata)
+{
+	dc_status_t status = DC_STATUS_SUCCESS;
+	divesoft_freedom_parser_t *parser = (divesoft_freedom_parser_t *) abstract;
+	divesoft_freedom_cursor_t cursor;
+	dc_sample_t samples[MAXSAMPLES];
+
+	status = divesoft_freedom_cursor_init (parser, &cursor);
+	if (status != DC_STATUS_SUCCESS)
+		return status;
+
+	while (cursor.position < parser->nrecords) {
+		unsigned int count = 0;
+		status = divesoft_freedom_decode_record (parser, &cursor, samples, &count);
+		if (callback) {
+			for (unsigned int i = 0; i < count; ++i) {
+				callback (samples[i].type, &samples[i].value, userdata);
+			}
+		}
+		if (status != DC_STATUS_SUCCESS)
+			return status;
+	}
+
+	return DC_STATUS_SUCCESS;
+}
+
+static dc_status_t
+divesoft_freedom_parser_samples_read (dc_parser_t *abstract, dc_sample_t samples[], unsigned int count, unsigned int *actual)
+{
+	dc_status_t status = DC_STATUS_SUCCESS;
+	divesoft_freedom_parser_t *parser = (divesoft_freedom_parser_t *) abstract;
+	unsigned int n = 0;
+
+	if (abstract->sample_rewind) {
+		status = divesoft_freedom_cursor_init (parser, &parser->cursor);
+		if (status != DC_STATUS_SUCCESS)
+			return status;
+
+		parser->cursor_status = DC_STATUS_SUCCESS;
+		parser->npending = 0;
+		parser->pendingpos = 0;
+		abstract->sample_rewind = 0;
+	}
+
+	while (n < count) {
+		// The samples left over from the previous record.
+		if (parser->pendingpos < parser->npending) {
+			samples[n++] = parser->pending[parser->pendingpos++];
+			continue;
+		}
+
+		if (parser->cursor_status != DC_STATUS_SUCCESS ||
+			parser->cursor.position >= parser->nrecords)
+			break;
+
+		// Decode straight into the caller's array, unless the record may
+		// not fit in the remaining space.
+		unsigned int ndecoded = 0;
+		if (count - n >= MAXSAMPLES) {
+			parser->cursor_status = divesoft_freedom_decode_record (parser, &parser->cursor, samples + n, &ndecoded);
+			n += ndecoded;
+		} else {
+			parser->cursor_status = divesoft_freedom_decode_record (parser, &parser->cursor, parser->pending, &ndecoded);
+			parser->npending = ndecoded;
+			parser->pendingpos = 0;
+		}
+	}
+
+	if (actual)
+		*actual = n;
+
+	if (parser->pendingpos < parser->npending)
+		return DC_STATUS_SUCCESS;
+
+	return parser->cursor_status;
+}
+
+dc_status_t
+divesoft_freedom_parser_index (dc_parser_t *abstract)
+{
+	dc_status_t status = DC_STATUS_SUCCESS;
+	divesoft_freedom_parser_t *parser = (divesoft_freedom_parser_t *) abstract;
+	const unsigned char *data = abstract->data;
+
+	if (!ISINSTANCE (abstract))
+		return DC_STATUS_INVALIDARGS;
+
+	if (parser->indexed)
+		return DC_STATUS_SUCCESS;
+
+	// The cache pass collects the records.
+	status = divesoft_freedom_cache (parser);
+	if (status != DC_STATUS_SUCCESS)
+		return status;
+
+	unsigned int nrecords = parser->nrecords;
+	unsigned int *times = NULL, *bytype = NULL;
+	if (nrecords) {
+		times = (unsigned int *) dc_context_alloc (abstract->context, nrecords * sizeof (unsigned int));
+		bytype = (unsigned int *) dc_context_alloc (abstract->context, nrecords * sizeof (unsigned int));
+		if (times == NULL || bytype == NULL) {
+			ERROR (abstract->context, "Failed to allocate memory.");
+			dc_context_release (abstract->context, times);
+			dc_context_release (abstract->context, bytype);
+			return DC_STATUS_NOMEMORY;
+		}
+	}
+
+	// Collect the timestamps, and count the records of each type.
+	unsigned int count[RECORD_TYPES] = {0};
+	unsigned int time = 0;
+	for (unsigned int i = 0; i < nrecords; ++i) {
+		unsigned int flags = array_uint32_le (data + parser->records[i]);
+		unsigned int timestamp = (flags & 0x001FFFF0) >> 4;
+		if (timestamp > time)
+			time = timestamp;
+		times[i] = time;
+		count[parser->types[i]]++;
+	}
+
+	// Group the records by type (a counting sort, which keeps the
+	// records of each type in their original order).
+	unsigned int typestart[RECORD_TYPES + 1] = {0};
+	for (unsigned int i = 0; i < RECORD_TYPES; ++i) {
+		typestart[i + 1] = typestart[i] + count[i];
+		count[i] = typestart[i];
+	}
+	for (unsigned int i = 0; i < nrecords; ++i) {
+		bytype[count[parser->types[i]]++] = i;
+	}
+
+	parser->indexed = 1;
+	parser->times = times;
+	parser->bytype = bytype;
+	for (unsigned int i = 0; i <= RECORD_TYPES; ++i) {
+		parser->typestart[i] = typestart[i];
+	}
+
+	return DC_STATUS_SUCCESS;
+}
+
+dc_status_t
+divesoft_freedom_parser_records_foreach (dc_parser_t *abstract, unsigned int types, unsigned int begin, unsigned int end, divesoft_freedom_record_callback_t callback, void *userdata)
+{
+	dc_status_t status = DC_STATUS_SUCCESS;
+	divesoft_freedom_parser_t *parser = (divesoft_freedom_parser_t *) abstract;
+	const unsigned char *data = abstract->data;
+
+	if (!ISINSTANCE (abstract) || callback == NULL)
+		return DC_STATUS_INVALIDARGS;
+
+	status = divesoft_freedom_parser_index (abstract);
+	if (status != DC_STATUS_SUCCESS)
+		return status;
+
+	if (begin >= end)
+		return DC_STATUS_SUCCESS;
+
+	// Position a cursor at the start of the window, in the list of every
+	// selected record type.
+	unsigned int cursor[RECORD_TYPES], last[RECORD_TYPES];
+	unsigned int nlists = 0;
+	for (unsigned int i = 0; i < RECORD_TYPES; ++i) {
+		if ((types & (1u << i)) == 0 || parser->typestart[i] == parser->typestart[i + 1])
+			continue;
+		cursor[nlists] = divesoft_freedom_lower_bound (parser->times, parser->bytype,
+			parser->typestart[i], parser->typestart[i + 1], begin);
+		last[nlists] = parser->typestart[i + 1];
+		nlists++;
+	}
+
+	// Merge the lists, to report the records in their original order.
+	while (1) {
+		unsigned int list = nlists;
+		unsigned int pos = parser->nrecords;
+		for (unsigned int i = 0; i < nlists; ++i) {
+			if (cursor[i] < last[i] && parser->bytype[cursor[i]] < pos) {
+				pos = parser->bytype[cursor[i]];
+				list = i;
+			}
+		}
+
+		if (list == nlists || parser->times[pos] >= end)
+			break;
+
+		cursor[list]++;
+
+		unsigned int offset = parser->records[pos];
+		unsigned int flags = array_uint32_le (data + offset);
+
+		divesoft_freedom_record_t record;
+		record.type      = (flags & 0x0000000F) >> 0;
+		record.timestamp = (flags & 0x001FFFF0) >> 4;
+		record.id        = (flags & 0x7FE00000) >> 21;
+		record.offset    = offset;
+		record.data      = data + offset;
+		record.size      = RECORD_SIZE;
+		if (!callback (&record, userdata))
+			break;
+	}
+
+	return DC_STATUS_SUCCESS;
+}
+
+/*
+ * Unpack the loadings of 8 compartments, stored as pairs of 12 bit values
+ * in 3 bytes: the two low bytes, followed by the two high nibbles. The top
+ * bit of every value is a flag.
+ */
+static void
+divesoft_freedom_unpack_tissues (const unsigned char data[], unsigned int first, unsigned int loading[], unsigned int *flags)
+{
+	for (unsigned int i = 0; i < DIVESOFT_FREEDOM_NCOMPARTMENTS / 2; ++i) {
+		const unsigned char *p = data + (i / 2) * 3;
+		unsigned int shift = (i % 2) * 4;
+		unsigned int value = p[i % 2] | (((p[2] >> shift) & 0x0F) << 8);
+		unsigned int bit = 1u << (first + i);
+
+		loading[first + i] = value & 0x7FF;
+		if (value & 0x800) {
+			*flags |= bit;
+		} else {
+			*flags &= ~bit;
+		}
+	}
+}
+
+dc_status_t
+divesoft_freedom_parser_get_tissues (dc_parser_t *abstract, const divesoft_freedom_tissue_t **tissues, unsigned int *count)
+{
+	dc_status_t status = DC_STATUS_SUCCESS;
+	divesoft_freedom_parser_t *parser = (divesoft_freedom_parser_t *) abstract;
+	const unsigned char *data = abstract->data;
+
+	if (!ISINSTANCE (abstract) || tissues == NULL || count == NULL)
+		return DC_STATUS_INVALIDARGS;
+
+	*tissues = NULL;
+	*count = 0;
+
+	if (parser->tissues_cached) {
+		*tissues = parser->tissues;
+		*count = parser->ntissues;
+		return DC_STATUS_SUCCESS;
+	}
+
+	// The index has the state records grouped together.
+	status = divesoft_freedom_parser_index (abstract);
+	if (status != DC_STATUS_SUCCESS)
+		return status;
+
+	unsigned int first = parser->typestart[LREC_STATE];
+	unsigned int last = parser->typestart[LREC_STATE + 1];
+
+	// Count the distinct timestamps.
+	unsigned int n = 0;
+	unsigned int previous = UNDEFINED;
+	for (unsigned int i = first; i < last; ++i) {
+		unsigned int timestamp = (array_uint32_le (data + parser->records[parser->bytype[i]]) & 0x001FFFF0) >> 4;
+		if (timestamp != previous) {
+			previous = timestamp;
+			n++;
+		}
+	}
+
+	divesoft_freedom_tissue_t *timeline = NULL;
+	if (n) {
+		timeline = (divesoft_freedom_tissue_t *) dc_context_alloc (abstract->context, n * sizeof (divesoft_freedom_tissue_t));
+		if (timeline == NULL) {
+			ERROR (abstract->context, "Failed to allocate memory.");
+			return DC_STATUS_NOMEMORY;
+		}
+	}
+
+	divesoft_freedom_tissue_t state;
+	memset (&state, 0, sizeof (state));
+
+	unsigned int ntissues = 0;
+	previous = UNDEFINED;
+	for (unsigned int i = first; i < last; ++i) {
+		const unsigned char *record = data + parser->records[parser->bytype[i]];
+		unsigned int flags = array_uint32_le (record);
+		unsigned int timestamp = (flags & 0x001FFFF0) >> 4;
+		unsigned int id        = (flags & 0x7FE00000) >> 21;
+
+		// Store the state of the previous timestamp.
+		if (timestamp != previous && previous != UNDEFINED) {
+			timeline[ntissues++] = state;
+		}
+		previous = timestamp;
+		state.time = timestamp;
+
+		switch (id) {
+		case STATE_ID_DECO_N2LOW:
+		case STATE_ID_DECO_N2HIGH:
+			divesoft_freedom_unpack_tissues (record + 4,
+				id == STATE_ID_DECO_N2LOW ? 0 : DIVESOFT_FREEDOM_NCOMPARTMENTS / 2,
+				state.n2, &state.n2_flags);
+			state.valid |= DIVESOFT_FREEDOM_TISSUE_N2;
+			break;
+		case STATE_ID_DECO_HELOW:
+		case STATE_ID_DECO_HEHIGH:
+			divesoft_freedom_unpack_tissues (record + 4,
+				id == STATE_ID_DECO_HELOW ? 0 : DIVESOFT_FREEDOM_NCOMPARTMENTS / 2,
+				state.he, &state.he_flags);
+			state.valid |= DIVESOFT_FREEDOM_TISSUE_HE;
+			break;
+		default:
+			break;
+		}
+	}
+	if (previous != UNDEFINED) {
+		timeline[ntissues++] = state;
+	}
+
+	parser->tissues_cached = 1;
+	parser->tissues = timeline;
+	parser->ntissues = ntissues;
+
+	*tissues = timeline;
+	*count = ntissues;
+
+	return DC_STATUS_SUCCESS;
+}
+
+/*
+ * The stream keeps the header, and the bytes that are not decoded yet,
+ * in a buffer, and feeds the complete records to a regular parser. The
+ * decoding starts once the configuration records at the start of the
+ * profile are in, so the gas mixes and tanks are numbered the same way as
+ * by the regular parser.
+ */
+struct divesoft_freedom_stream_t {
+	divesoft_freedom_parser_t *parser;
+	unsigned int types;
+	unsigned char *buffer;
+	size_t size;
+	size_t capacity;
+	// End of the records passed to the parser.
+	size_t scanned;
+	unsigned int maxrecords;
+	unsigned int configured;
+	unsigned int finished;
+	dc_status_t status;
+};
+
+dc_status_t
+divesoft_freedom_stream_new (divesoft_freedom_stream_t **out, dc_context_t *context, unsigned int types)
+{
+	dc_status_t status = DC_STATUS_SUCCESS;
+	divesoft_freedom_stream_t *stream = NULL;
+	dc_parser_t *parser = NULL;
+
+	if (out == NULL)
+		return DC_STATUS_INVALIDARGS;
+
+	// Allocate memory.
+	stream = (divesoft_freedom_stream_t *) dc_context_alloc (context, sizeof (divesoft_freedom_stream_t));
+	if (stream == NULL) {
+		ERROR (context, "Failed to allocate memory.");
+		return DC_STATUS_NOMEMORY;
+	}
+
+	// The parser starts without data. It is pointed at the buffer as soon
+	// as there is something to decode.
+	status = divesoft_freedom_parser_create (&parser, context, NULL, 0);
+	if (status != DC_STATUS_SUCCESS) {
+		dc_context_release (context, stream);
+		return status;
+	}
+
+	parser->sample_types = types;
+	parser->sample_rewind = 0;
+
+	stream->parser = (divesoft_freedom_parser_t *) parser;
+	stream->parser->incremental = 1;
+	stream->parser->cursor.position = 0;
+	stream->parser->cursor.time = UNDEFINED;
+	stream->parser->cursor.initial = 0;
+	stream->parser->cursor_status = DC_STATUS_SUCCESS;
+	stream->parser->npending = 0;
+	stream->parser->pendingpos = 0;
+	stream->types = types;
+	stream->buffer = NULL;
+	stream->size = 0;
+	stream->capacity = 0;
+	stream->scanned = 0;
+	stream->maxrecords = 0;
+	stream->configured = 0;
+	stream->finished = 0;
+	stream->status = DC_STATUS_SUCCESS;
+
+	*out = stream;
+
+	return DC_STATUS_SUCCESS;
+}
+
+dc_status_t
+divesoft_freedom_stream_free (divesoft_freedom_stream_t *stream)
+{
+	if (stream == NULL)
+		return DC_STATUS_SUCCESS;
+
+	dc_context_t *context = stream->parser->base.context;
+
+	dc_parser_destroy ((dc_parser_t *) stream->parser);
+	dc_context_release (context, stream->buffer);
+	dc_context_release (context, stream);
+
+	return DC_STATUS_SUCCESS;
+}
+
+/*
+ * Drop the bytes of the records that are decoded already. The header is
+ * kept in front of the buffer.
+ */
+static void
+divesoft_freedom_stream_compact (divesoft_freedom_stream_t *stream)
+{
+	divesoft_freedom_parser_t *parser = stream->parser;
+
+	if (!stream->configured)
+		return;
+
+	unsigned int position = parser->cursor.position;
+	size_t end = position < parser->nrecords ? parser->records[position] : stream->scanned;
+	if (end <= parser->headersize)
+		return;
+
+	unsigned int delta = end - parser->headersize;
+	memmove (stream->buffer + parser->headersize, stream->buffer + end, stream->size - end);
+	stream->size -= delta;
+	stream->scanned -= delta;
+
+	for (unsigned int i = position; i < parser->nrecords; ++i) {
+		parser->records[i - position] = parser->records[i] - delta;
+		parser->types[i - position] = parser->types[i];
+	}
+	parser->nrecords -= position;
+	parser->cursor.position = 0;
+}
+
+dc_status_t
+divesoft_freedom_stream_feed (divesoft_freedom_stream_t *stream, const unsigned char data[], size_t size)
+{
+	if (stream == NULL || (data == NULL && size))
+		return DC_STATUS_INVALIDARGS;
+
+	dc_context_t *context = stream->parser->base.context;
+
+	if (stream->finished) {
+		ERROR (context, "The stream is already finished.");
+		return DC_STATUS_INVALIDARGS;
+	}
+
+	divesoft_freedom_stream_compact (stream);
+
+	if (size > stream->capacity - stream->size) {
+		size_t capacity = stream->capacity ? stream->capacity * 2 : 1024;
+		while (capacity < stream->size + size) {
+			capacity *= 2;
+		}
+		unsigned char *buffer = (unsigned char *) dc_context_realloc (context, stream->buffer, capacity);
+		if (buffer == NULL) {
+			ERROR (context, "Failed to allocate memory.");
+			return DC_STATUS_NOMEMORY;
+		}
+		stream->buffer = buffer;
+		stream->capacity = capacity;
+	}
+
+	if (size) {
+		memcpy (stream->buffer + stream->size, data, size);
+		stream->size += size;
+	}
+
+	return DC_STATUS_SUCCESS;
+}
+
+dc_status_t
+divesoft_freedom_stream_finish (divesoft_freedom_stream_t *stream)
+{
+	if (stream == NULL)
+		return DC_STATUS_INVALIDARGS;
+
+	stream->finished = 1;
+
+	return DC_STATUS_SUCCESS;
+}
+
+/*
+ * Parse the header and the configuration records with the regular cache
+ * pass, once they are complete: at the first record of another type, or
+ * at the end of the data.
+ */
+static dc_status_t
+divesoft_freedom_stream_configure (divesoft_freedom_stream_t *stream)
+{
+	dc_status_t status = DC_STATUS_SUCCESS;
+	divesoft_freedom_parser_t *parser = stream->parser;
+	const unsigned char *data = stream->buffer;
+	size_t size = stream->size;
+
+	const divesoft_freedom_layout_t *layout = NULL;
+	unsigned int ready = stream->finished;
+	if (size >= 4) {
+		layout = divesoft_freedom_find_layout (array_uint32_le (data));
+		if (layout == NULL) {
+			// Let the cache pass report the error.
+			ready = 1;
+		} else {
+			for (size_t offset = layout->headersize; offset + RECORD_SIZE <= size; offset += RECORD_SIZE) {
+				if (array_isequal (data + offset, RECORD_SIZE, 0xFF))
+					continue;
+				if ((data[offset] & 0x0F) != LREC_CONFIGURATION) {
+					ready = 1;
+					break;
 				}
 			}
-		} else if (type == LREC_STATE) {
-			// Tissue saturation record.
 		}
+	}
 
-		offset += RECORD_SIZE;
+	if (!ready)
+		return DC_STATUS_SUCCESS;
+
+	// Only the complete records, unless this is all the data.
+	size_t end = size;
+	if (layout && size > layout->headersize) {
+		end = layout->headersize + (size - layout->headersize) / RECORD_SIZE * RECORD_SIZE;
+		if (stream->finished)
+			end = size;
+	}
+
+	parser->base.data = data;
+	parser->base.size = end;
+
+	status = divesoft_freedom_cache (parser);
+	if (status != DC_STATUS_SUCCESS)
+		return status;
+
+	stream->scanned = parser->headersize + (end - parser->headersize) / RECORD_SIZE * RECORD_SIZE;
+	stream->maxrecords = (stream->scanned - parser->headersize) / RECORD_SIZE;
+	stream->configured = 1;
+
+	return DC_STATUS_SUCCESS;
+}
+
+/*
+ * Pass the records that are complete since the last call to the parser.
+ */
+static dc_status_t
+divesoft_freedom_stream_scan (divesoft_freedom_stream_t *stream)
+{
+	divesoft_freedom_parser_t *parser = stream->parser;
+	dc_context_t *context = parser->base.context;
+	const unsigned char *data = stream->buffer;
+
+	unsigned int n = (stream->size - stream->scanned) / RECORD_SIZE;
+	if (n == 0)
+		return DC_STATUS_SUCCESS;
+
+	if (parser->nrecords + n > stream->maxrecords) {
+		unsigned int maxrecords = parser->nrecords + n;
+		unsigned int *records = (unsigned int *) dc_context_realloc (context, parser->records, maxrecords * sizeof (unsigned int));
+		if (records == NULL) {
+			ERROR (context, "Failed to allocate memory.");
+			return DC_STATUS_NOMEMORY;
+		}
+		parser->records = records;
+
+		unsigned char *types = (unsigned char *) dc_context_realloc (context, parser->types, maxrecords);
+		if (types == NULL) {
+			ERROR (context, "Failed to allocate memory.");
+			return DC_STATUS_NOMEMORY;
+		}
+		parser->types = types;
+
+		stream->maxrecords = maxrecords;
+	}
+
+	for (unsigned int i = 0; i < n; ++i) {
+		size_t offset = stream->scanned + i * RECORD_SIZE;
+		if (array_isequal (data + offset, RECORD_SIZE, 0xFF)) {
+			WARNING (context, "Skipping empty sample.");
+			continue;
+		}
+		parser->records[parser->nrecords] = offset;
+		parser->types[parser->nrecords] = data[offset] & 0x0F;
+		parser->nrecords++;
 	}
+	stream->scanned += n * RECORD_SIZE;
 
 	return DC_STATUS_SUCCESS;
 }
+
+dc_status_t
+divesoft_freedom_stream_drain (divesoft_freedom_stream_t *stream, dc_sample_t samples[], unsigned int count, unsigned int *actual)
+{
+	dc_status_t status = DC_STATUS_SUCCESS;
+	unsigned int n = 0;
+
+	if (actual)
+		*actual = 0;
+
+	if (stream == NULL || (samples == NULL && count))
+		return DC_STATUS_INVALIDARGS;
+
+	if (stream->status != DC_STATUS_SUCCESS)
+		return stream->status;
+
+	if (!stream->configured) {
+		status = divesoft_freedom_stream_configure (stream);
+		if (status != DC_STATUS_SUCCESS) {
+			stream->status = status;
+			return status;
+		}
+		if (!stream->configured)
+			return DC_STATUS_SUCCESS;
+	}
+
+	status = divesoft_freedom_stream_scan (stream);
+	if (status != DC_STATUS_SUCCESS) {
+		stream->status = status;
+		return status;
+	}
+
+	dc_parser_t *parser = (dc_parser_t *) stream->parser;
+	parser->data = stream->buffer;
+	parser->size = stream->scanned;
+
+	while (n < count) {
+		unsigned int nread = 0;
+		status = divesoft_freedom_parser_samples_read (parser, samples + n, count - n, &nread);
+
+		// The decoder only takes the sample types as a hint.
+		unsigned int end = n + nread;
+		for (unsigned int i = n; i < end; ++i) {
+			if (stream->types & DC_SAMPLE_MASK (samples[i].type))
+				samples[n++] = samples[i];
+		}
+
+		if (status != DC_STATUS_SUCCESS || nread == 0)
+			break;
+	}
+
+	if (actual)
+		*actual = n;
+
+	return status;
+}
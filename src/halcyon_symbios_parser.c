@@ -121,7 +121,10 @@ static const dc_parser_vtable_t halcyon_symbios_parser_vtable = {
 	halcyon_symbios_parser_get_datetime, /* datetime */
 	halcyon_symbios_parser_get_field, /* fields */
 	halcyon_symbios_parser_samples_foreach, /* samples_foreach */
-	NULL /* destroy */
+	NULL, /* destroy */
+	NULL, /* samples_read */
+	NULL, /* reset */
+	NULL /* summary */
 };
 
 dc_status_t
@@ -59,6 +59,12 @@ typedef struct dc_hdlc_t {
 	size_t rbuf_available;
 	size_t wbuf_size;
 	size_t wbuf_offset;
+	/* Checksum of the received frames. */
+	unsigned int checksum;
+	checksum_crc_t crc_init;
+	checksum_crc_t crc;
+	size_t crc_trailer;
+	size_t crc_offset;
 } dc_hdlc_t;
 
 static const dc_iostream_vtable_t dc_hdlc_vtable = {
@@ -125,6 +131,9 @@ dc_hdlc_open (dc_iostream_t **out, dc_context_t *context, dc_iostream_t *base, s
 	hdlc->rbuf_available = 0;
 	hdlc->wbuf_size = osize;
 	hdlc->wbuf_offset = 0;
+	hdlc->checksum = 0;
+	hdlc->crc_trailer = 0;
+	hdlc->crc_offset = 0;
 
 	*out = (dc_iostream_t *) hdlc;
 
@@ -138,6 +147,56 @@ error_exit:
 	return status;
 }
 
+dc_status_t
+dc_hdlc_set_checksum (dc_iostream_t *abstract, checksum_crc_type_t type, unsigned int init, unsigned int xorout, size_t trailer)
+{
+	dc_hdlc_t *hdlc = (dc_hdlc_t *) abstract;
+
+	if (!dc_iostream_isinstance (abstract, &dc_hdlc_vtable))
+		return DC_STATUS_INVALIDARGS;
+
+	checksum_crc_init (&hdlc->crc_init, type, init, xorout);
+	hdlc->crc = hdlc->crc_init;
+	hdlc->crc_trailer = trailer;
+	hdlc->checksum = 1;
+
+	return DC_STATUS_SUCCESS;
+}
+
+dc_status_t
+dc_hdlc_get_checksum (dc_iostream_t *abstract, unsigned int *value)
+{
+	dc_hdlc_t *hdlc = (dc_hdlc_t *) abstract;
+
+	if (!dc_iostream_isinstance (abstract, &dc_hdlc_vtable) || value == NULL)
+		return DC_STATUS_INVALIDARGS;
+
+	if (!hdlc->checksum)
+		return DC_STATUS_UNSUPPORTED;
+
+	*value = checksum_crc_final (&hdlc->crc);
+
+	return DC_STATUS_SUCCESS;
+}
+
+/*
+ * Fold the unescaped bytes received so far into the checksum, while they
+ * are still in the cache. The trailing bytes are held back, until the
+ * end of the frame shows they are not part of the checksum itself.
+ */
+static void
+dc_hdlc_fold (dc_hdlc_t *hdlc, const unsigned char data[], size_t size)
+{
+	if (!hdlc->checksum || size <= hdlc->crc_trailer)
+		return;
+
+	size_t end = size - hdlc->crc_trailer;
+	if (end > hdlc->crc_offset) {
+		checksum_crc_update (&hdlc->crc, data + hdlc->crc_offset, end - hdlc->crc_offset);
+		hdlc->crc_offset = end;
+	}
+}
+
 static dc_status_t
 dc_hdlc_set_timeout (dc_iostream_t *abstract, int timeout)
 {
@@ -208,8 +267,15 @@ dc_hdlc_read (dc_iostream_t *abstract, void *data, size_t size, size_t *actual)
 	unsigned int initialized = 0;
 	unsigned int escaped = 0;
 
+	if (hdlc->checksum) {
+		hdlc->crc = hdlc->crc_init;
+		hdlc->crc_offset = 0;
+	}
+
 	while (1) {
 		if (hdlc->rbuf_available == 0) {
+			dc_hdlc_fold (hdlc, data, nbytes < size ? nbytes : size);
+
 			// Read a packet into the cache.
 			size_t len = 0;
 			status = dc_iostream_read (hdlc->iostream, hdlc->rbuf, hdlc->rbuf_size, &len);
@@ -267,6 +333,8 @@ dc_hdlc_read (dc_iostream_t *abstract, void *data, size_t size, size_t *actual)
 	}
 
 out:
+	dc_hdlc_fold (hdlc, data, nbytes < size ? nbytes : size);
+
 	if (nbytes > size) {
 		ERROR (hdlc->context, "HDLC frame is too large (" DC_PRINTF_SIZE " " DC_PRINTF_SIZE ").", nbytes, size);
 		dc_status_set_error (&status, DC_STATUS_IO);
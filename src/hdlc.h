@@ -26,6 +26,8 @@
 #include <libdivecomputer/context.h>
 #include <libdivecomputer/iostream.h>
 
+#include "checksum.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif /* __cplusplus */
@@ -44,6 +46,36 @@ extern "C" {
 dc_status_t
 dc_hdlc_open (dc_iostream_t **iostream, dc_context_t *context, dc_iostream_t *base, size_t isize, size_t osize);
 
+/**
+ * Compute a CRC over every received frame, while it is being unescaped.
+ *
+ * The CRC covers the frame without its last bytes, where the checksum
+ * itself is usually stored. It is available with #dc_hdlc_get_checksum
+ * after every read.
+ *
+ * @param[in]   iostream    A valid HDLC I/O stream.
+ * @param[in]   type        The type of the CRC.
+ * @param[in]   init        The initial value of the CRC.
+ * @param[in]   xorout      The final xor value of the CRC.
+ * @param[in]   trailer     The number of bytes at the end of the frame
+ *                          that are not covered by the CRC.
+ * @returns #DC_STATUS_SUCCESS on success, or another #dc_status_t code
+ * on failure.
+ */
+dc_status_t
+dc_hdlc_set_checksum (dc_iostream_t *iostream, checksum_crc_type_t type, unsigned int init, unsigned int xorout, size_t trailer);
+
+/**
+ * Get the CRC of the last received frame.
+ *
+ * @param[in]   iostream    A valid HDLC I/O stream.
+ * @param[out]  value       A location to store the CRC.
+ * @returns #DC_STATUS_SUCCESS on success, #DC_STATUS_UNSUPPORTED if no
+ * CRC is configured, or another #dc_status_t code on failure.
+ */
+dc_status_t
+dc_hdlc_get_checksum (dc_iostream_t *iostream, unsigned int *value);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
@@ -71,7 +71,10 @@ static const dc_parser_vtable_t mclean_extreme_parser_vtable = {
 	mclean_extreme_parser_get_datetime, /* datetime */
 	mclean_extreme_parser_get_field, /* fields */
 	mclean_extreme_parser_samples_foreach, /* samples_foreach */
-	NULL /* destroy */
+	NULL, /* destroy */
+	NULL, /* samples_read */
+	NULL, /* reset */
+	NULL /* summary */
 };
 
 dc_status_t
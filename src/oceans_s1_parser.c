@@ -71,7 +71,10 @@ static const dc_parser_vtable_t oceans_s1_parser_vtable = {
 	oceans_s1_parser_get_datetime, /* datetime */
 	oceans_s1_parser_get_field, /* fields */
 	oceans_s1_parser_samples_foreach, /* samples_foreach */
-	NULL /* destroy */
+	NULL, /* destroy */
+	NULL, /* samples_read */
+	NULL, /* reset */
+	NULL /* summary */
 };
 
 dc_status_t
@@ -41,8 +41,27 @@ typedef struct dc_parser_vtable_t dc_parser_vtable_t;
 struct dc_parser_t {
 	const dc_parser_vtable_t *vtable;
 	dc_context_t *context;
-	unsigned char *data;
+	const unsigned char *data;
 	unsigned int size;
+	unsigned char *buffer;
+	/* Size of the private copy, and whether the data is borrowed
+	 * instead (see dc_parser_reset). */
+	unsigned int capacity;
+	unsigned int borrowed;
+	/* Sample filter (see dc_parser_samples_foreach_filtered). Backends
+	 * may use it to skip work, but don't have to. */
+	unsigned int sample_types;
+	unsigned int sample_begin;
+	unsigned int sample_end;
+	/* Batched samples (see dc_parser_samples_read). The rewind flag tells
+	 * the backend to start again from the beginning. The other fields are
+	 * only used for backends without a native implementation. */
+	unsigned int sample_rewind;
+	dc_sample_t *samples;
+	unsigned int nsamples;
+	unsigned int sample_capacity;
+	unsigned int sample_position;
+	dc_status_t sample_status;
 };
 
 struct dc_parser_vtable_t {
@@ -63,6 +82,12 @@ struct dc_parser_vtable_t {
 	dc_status_t (*samples_foreach) (dc_parser_t *parser, dc_sample_callback_t callback, void *userdata);
 
 	dc_status_t (*destroy) (dc_parser_t *parser);
+
+	dc_status_t (*samples_read) (dc_parser_t *parser, dc_sample_t samples[], unsigned int count, unsigned int *actual);
+
+	dc_status_t (*reset) (dc_parser_t *parser);
+
+	dc_status_t (*summary) (dc_parser_t *parser, dc_summary_t *summary);
 };
 
 dc_parser_t *
@@ -74,6 +99,18 @@ dc_parser_deallocate (dc_parser_t *parser);
 int
 dc_parser_isinstance (dc_parser_t *parser, const dc_parser_vtable_t *vtable);
 
+typedef dc_status_t (*dc_parser_field_t) (dc_parser_t *parser, dc_field_type_t type, unsigned int flags, void *value);
+
+/*
+ * Fill the summary by querying every field. Backends with a native
+ * summary cache their data once, and pass a field function that does
+ * not check the cache again.
+ */
+dc_status_t
+dc_parser_fill_summary (dc_parser_t *parser, dc_parser_field_t field, dc_summary_t *summary);
+
+#define DC_PARSER_WANTS(parser,mask) (((parser)->sample_types & (mask)) != 0)
+
 typedef struct sample_statistics_t {
 	unsigned int divetime;
 	double maxdepth;
@@ -70,18 +70,33 @@
 #include "context-private.h"
 #include "parser-private.h"
 #include "device-private.h"
+#include "array.h"
 
 #define REACTPROWHITE 0x4354
 
 static dc_status_t
-dc_parser_new_internal (dc_parser_t **out, dc_context_t *context, const unsigned char data[], size_t size, dc_family_t family, unsigned int model)
+dc_parser_new_internal (dc_parser_t **out, dc_context_t *context, const unsigned char data[], size_t size, dc_family_t family, unsigned int model, unsigned int borrowed)
 {
 	dc_status_t rc = DC_STATUS_SUCCESS;
 	dc_parser_t *parser = NULL;
+	unsigned char *buffer = NULL;
 
 	if (out == NULL)
 		return DC_STATUS_INVALIDARGS;
 
+	if (!borrowed && size) {
+		// Allocate memory for the data.
+		buffer = (unsigned char *) dc_context_alloc (context, size);
+		if (buffer == NULL) {
+			ERROR (context, "Failed to allocate memory.");
+			return DC_STATUS_NOMEMORY;
+		}
+
+		// Copy the data.
+		memcpy (buffer, data, size);
+		data = buffer;
+	}
+
 	switch (family) {
 	case DC_FAMILY_SUUNTO_SOLUTION:
 		rc = suunto_solution_parser_create (&parser, context, data, size);
@@ -210,9 +225,20 @@ dc_parser_new_internal (dc_parser_t **out, dc_context_t *context, const unsigned
 		rc = halcyon_symbios_parser_create (&parser, context, data, size);
 		break;
 	default:
-		return DC_STATUS_INVALIDARGS;
+		rc = DC_STATUS_INVALIDARGS;
+		break;
+	}
+
+	if (rc != DC_STATUS_SUCCESS) {
+		dc_context_release (context, buffer);
+		return rc;
 	}
 
+	// The parser takes ownership of the private copy.
+	parser->buffer = buffer;
+	parser->capacity = buffer ? size : 0;
+	parser->borrowed = borrowed;
+
 	*out = parser;
 
 	return rc;
@@ -228,7 +254,7 @@ dc_parser_new (dc_parser_t **out, dc_device_t *device, const unsigned char data[
 		return DC_STATUS_INVALIDARGS;
 
 	status = dc_parser_new_internal (&parser, device->context, data, size,
-		dc_device_get_type (device), device->devinfo.model);
+		dc_device_get_type (device), device->devinfo.model, 0);
 	if (status != DC_STATUS_SUCCESS)
 		goto error_exit;
 
@@ -250,7 +276,14 @@ dc_status_t
 dc_parser_new2 (dc_parser_t **out, dc_context_t *context, dc_descriptor_t *descriptor, const unsigned char data[], size_t size)
 {
 	return dc_parser_new_internal (out, context, data, size,
-		dc_descriptor_get_type (descriptor), dc_descriptor_get_model (descriptor));
+		dc_descriptor_get_type (descriptor), dc_descriptor_get_model (descriptor), 0);
+}
+
+dc_status_t
+dc_parser_new2_borrowed (dc_parser_t **out, dc_context_t *context, dc_descriptor_t *descriptor, const unsigned char data[], size_t size)
+{
+	return dc_parser_new_internal (out, context, data, size,
+		dc_descriptor_get_type (descriptor), dc_descriptor_get_model (descriptor), 1);
 }
 
 dc_parser_t *
@@ -262,33 +295,31 @@ dc_parser_allocate (dc_context_t *context, const dc_parser_vtable_t *vtable, con
 	assert(vtable->size >= sizeof(dc_parser_t));
 
 	// Allocate memory.
-	parser = (dc_parser_t *) malloc (vtable->size);
+	parser = (dc_parser_t *) dc_context_alloc (context, vtable->size);
 	if (parser == NULL) {
 		ERROR (context, "Failed to allocate memory.");
 		return parser;
 	}
 
-	// Initialize the base class.
+	// Initialize the base class. The data is either a private copy, or
+	// borrowed from the caller, but never owned by the backend.
 	parser->vtable = vtable;
 	parser->context = context;
+	parser->data = size ? data : NULL;
+	parser->size = size;
+	parser->buffer = NULL;
+	parser->capacity = 0;
+	parser->borrowed = 0;
+	parser->sample_types = DC_SAMPLE_MASK_ALL;
+	parser->sample_begin = 0;
+	parser->sample_end = DC_SAMPLE_TIME_END;
+	parser->sample_rewind = 1;
+	parser->samples = NULL;
+	parser->nsamples = 0;
+	parser->sample_capacity = 0;
+	parser->sample_position = 0;
+	parser->sample_status = DC_STATUS_SUCCESS;
 
-	if (size) {
-		// Allocate memory for the data.
-		parser->data = malloc (size);
-		if (parser->data == NULL) {
-			ERROR (context, "Failed to allocate memory.");
-			free (parser);
-			return NULL;
-		}
-
-		// Copy the data.
-		memcpy (parser->data, data, size);
-		parser->size = size;
-	} else {
-		parser->data = NULL;
-		parser->size = 0;
-
-	}
 	return parser;
 }
 
@@ -298,8 +329,9 @@ dc_parser_deallocate (dc_parser_t *parser)
 	if (parser == NULL)
 		return;
 
-	free (parser->data);
-	free (parser);
+	dc_context_release (parser->context, parser->samples);
+	dc_context_release (parser->context, parser->buffer);
+	dc_context_release (parser->context, parser);
 }
 
 int
@@ -386,6 +418,92 @@ dc_parser_get_field (dc_parser_t *parser, dc_field_type_t type, unsigned int fla
 }
 
 
+/*
+ * Query one field of the summary. A field that is not supported is not
+ * an error. For the other errors, only the first one is kept.
+ */
+static void
+dc_parser_summary_field (dc_parser_t *parser, dc_parser_field_t field, dc_summary_t *summary, dc_field_type_t type, unsigned int flags, void *value, dc_status_t *error)
+{
+	dc_status_t status = field (parser, type, flags, value);
+	if (status == DC_STATUS_SUCCESS) {
+		summary->fields |= DC_FIELD_MASK(type);
+	} else if (status != DC_STATUS_UNSUPPORTED && *error == DC_STATUS_SUCCESS) {
+		*error = status;
+	}
+}
+
+dc_status_t
+dc_parser_fill_summary (dc_parser_t *parser, dc_parser_field_t field, dc_summary_t *summary)
+{
+	dc_status_t status = DC_STATUS_SUCCESS;
+
+	summary->fields = 0;
+
+	const struct {
+		dc_field_type_t type;
+		void *value;
+	} fields[] = {
+		{DC_FIELD_DIVETIME,            &summary->divetime},
+		{DC_FIELD_MAXDEPTH,            &summary->maxdepth},
+		{DC_FIELD_AVGDEPTH,            &summary->avgdepth},
+		{DC_FIELD_TEMPERATURE_SURFACE, &summary->temperature_surface},
+		{DC_FIELD_TEMPERATURE_MINIMUM, &summary->temperature_minimum},
+		{DC_FIELD_TEMPERATURE_MAXIMUM, &summary->temperature_maximum},
+		{DC_FIELD_SALINITY,            &summary->salinity},
+		{DC_FIELD_ATMOSPHERIC,         &summary->atmospheric},
+		{DC_FIELD_DIVEMODE,            &summary->divemode},
+		{DC_FIELD_DECOMODEL,           &summary->decomodel},
+		{DC_FIELD_LOCATION,            &summary->location},
+		{DC_FIELD_GASMIX_COUNT,        &summary->ngasmixes},
+		{DC_FIELD_TANK_COUNT,          &summary->ntanks},
+	};
+
+	for (unsigned int i = 0; i < C_ARRAY_SIZE(fields); ++i) {
+		dc_parser_summary_field (parser, field, summary, fields[i].type, 0, fields[i].value, &status);
+	}
+
+	// Without a valid count, the gas mixes and tanks are not read.
+	if ((summary->fields & DC_FIELD_MASK(DC_FIELD_GASMIX_COUNT)) == 0)
+		summary->ngasmixes = 0;
+	if ((summary->fields & DC_FIELD_MASK(DC_FIELD_TANK_COUNT)) == 0)
+		summary->ntanks = 0;
+
+	unsigned int ngasmixes = summary->ngasmixes < DC_SUMMARY_MAXGASMIXES ? summary->ngasmixes : DC_SUMMARY_MAXGASMIXES;
+	for (unsigned int i = 0; i < ngasmixes; ++i) {
+		dc_parser_summary_field (parser, field, summary, DC_FIELD_GASMIX, i, &summary->gasmix[i], &status);
+	}
+
+	unsigned int ntanks = summary->ntanks < DC_SUMMARY_MAXTANKS ? summary->ntanks : DC_SUMMARY_MAXTANKS;
+	for (unsigned int i = 0; i < ntanks; ++i) {
+		dc_parser_summary_field (parser, field, summary, DC_FIELD_TANK, i, &summary->tank[i], &status);
+	}
+
+	return status;
+}
+
+dc_status_t
+dc_parser_get_summary (dc_parser_t *parser, dc_summary_t *summary)
+{
+	if (parser == NULL)
+		return DC_STATUS_UNSUPPORTED;
+
+	if (summary == NULL)
+		return DC_STATUS_INVALIDARGS;
+
+	// Nothing is available if the backend fails before filling it in.
+	memset (summary, 0, sizeof (*summary));
+
+	if (parser->vtable->summary)
+		return parser->vtable->summary (parser, summary);
+
+	if (parser->vtable->field == NULL)
+		return DC_STATUS_UNSUPPORTED;
+
+	return dc_parser_fill_summary (parser, parser->vtable->field, summary);
+}
+
+
 dc_status_t
 dc_parser_samples_foreach (dc_parser_t *parser, dc_sample_callback_t callback, void *userdata)
 {
@@ -399,6 +517,209 @@ dc_parser_samples_foreach (dc_parser_t *parser, dc_sample_callback_t callback, v
 }
 
 
+typedef struct sample_filter_t {
+	unsigned int types;
+	unsigned int begin;
+	unsigned int end;
+	unsigned int time;
+	dc_sample_callback_t callback;
+	void *userdata;
+} sample_filter_t;
+
+static void
+dc_parser_filter_cb (dc_sample_type_t type, const dc_sample_value_t *value, void *userdata)
+{
+	sample_filter_t *filter = (sample_filter_t *) userdata;
+
+	if (type == DC_SAMPLE_TIME)
+		filter->time = value->time;
+
+	if (filter->time < filter->begin || filter->time >= filter->end)
+		return;
+
+	if ((filter->types & DC_SAMPLE_MASK (type)) == 0)
+		return;
+
+	filter->callback (type, value, filter->userdata);
+}
+
+dc_status_t
+dc_parser_samples_foreach_filtered (dc_parser_t *parser, unsigned int types, unsigned int begin, unsigned int end, dc_sample_callback_t callback, void *userdata)
+{
+	dc_status_t status = DC_STATUS_SUCCESS;
+
+	if (parser == NULL)
+		return DC_STATUS_UNSUPPORTED;
+
+	if (parser->vtable->samples_foreach == NULL)
+		return DC_STATUS_UNSUPPORTED;
+
+	// The backend only sees the filter as a hint. The wrapper callback
+	// applies it to every backend, whether it skips any work or not.
+	sample_filter_t filter = {types, begin, end, 0, callback, userdata};
+
+	parser->sample_types = types;
+	parser->sample_begin = begin;
+	parser->sample_end = end;
+
+	status = parser->vtable->samples_foreach (parser, callback ? dc_parser_filter_cb : NULL, &filter);
+
+	parser->sample_types = DC_SAMPLE_MASK_ALL;
+	parser->sample_begin = 0;
+	parser->sample_end = DC_SAMPLE_TIME_END;
+
+	return status;
+}
+
+
+typedef struct sample_collect_t {
+	dc_context_t *context;
+	dc_sample_t *samples;
+	unsigned int count;
+	unsigned int capacity;
+	unsigned int error;
+} sample_collect_t;
+
+static void
+dc_parser_collect_cb (dc_sample_type_t type, const dc_sample_value_t *value, void *userdata)
+{
+	sample_collect_t *collect = (sample_collect_t *) userdata;
+
+	if (collect->error)
+		return;
+
+	if (collect->count >= collect->capacity) {
+		unsigned int capacity = collect->capacity ? collect->capacity * 2 : 1024;
+		dc_sample_t *samples = (dc_sample_t *) dc_context_realloc (collect->context, collect->samples, capacity * sizeof (dc_sample_t));
+		if (samples == NULL) {
+			collect->error = 1;
+			return;
+		}
+		collect->samples = samples;
+		collect->capacity = capacity;
+	}
+
+	collect->samples[collect->count].type = type;
+	collect->samples[collect->count].value = *value;
+	collect->count++;
+}
+
+/*
+ * Fallback for the backends without a native implementation: all samples
+ * are collected on the first call, and then handed out in batches.
+ */
+static dc_status_t
+dc_parser_samples_read_generic (dc_parser_t *parser, dc_sample_t samples[], unsigned int count, unsigned int *actual)
+{
+	if (parser->sample_rewind) {
+		sample_collect_t collect = {parser->context, parser->samples, 0, parser->sample_capacity, 0};
+
+		parser->sample_status = parser->vtable->samples_foreach (parser, dc_parser_collect_cb, &collect);
+		if (collect.error) {
+			ERROR (parser->context, "Failed to allocate memory.");
+			parser->sample_status = DC_STATUS_NOMEMORY;
+		}
+
+		// The buffer is kept, and reused after a rewind.
+		parser->samples = collect.samples;
+		parser->sample_capacity = collect.capacity;
+		parser->nsamples = collect.count;
+		parser->sample_position = 0;
+		parser->sample_rewind = 0;
+	}
+
+	unsigned int available = parser->nsamples - parser->sample_position;
+	unsigned int n = count < available ? count : available;
+	if (n) {
+		memcpy (samples, parser->samples + parser->sample_position, n * sizeof (dc_sample_t));
+	}
+	parser->sample_position += n;
+
+	if (actual)
+		*actual = n;
+
+	if (parser->sample_position == parser->nsamples)
+		return parser->sample_status;
+
+	return DC_STATUS_SUCCESS;
+}
+
+dc_status_t
+dc_parser_samples_read (dc_parser_t *parser, dc_sample_t samples[], unsigned int count, unsigned int *actual)
+{
+	if (actual)
+		*actual = 0;
+
+	if (parser == NULL)
+		return DC_STATUS_UNSUPPORTED;
+
+	if (samples == NULL && count)
+		return DC_STATUS_INVALIDARGS;
+
+	if (parser->vtable->samples_read)
+		return parser->vtable->samples_read (parser, samples, count, actual);
+
+	if (parser->vtable->samples_foreach == NULL)
+		return DC_STATUS_UNSUPPORTED;
+
+	return dc_parser_samples_read_generic (parser, samples, count, actual);
+}
+
+dc_status_t
+dc_parser_samples_rewind (dc_parser_t *parser)
+{
+	if (parser == NULL)
+		return DC_STATUS_UNSUPPORTED;
+
+	parser->sample_rewind = 1;
+
+	return DC_STATUS_SUCCESS;
+}
+
+
+dc_status_t
+dc_parser_reset (dc_parser_t *parser, const unsigned char data[], size_t size)
+{
+	dc_status_t status = DC_STATUS_SUCCESS;
+
+	if (parser == NULL || parser->vtable->reset == NULL)
+		return DC_STATUS_UNSUPPORTED;
+
+	if (data == NULL && size)
+		return DC_STATUS_INVALIDARGS;
+
+	status = parser->vtable->reset (parser);
+	if (status != DC_STATUS_SUCCESS)
+		return status;
+
+	parser->sample_rewind = 1;
+
+	// Grow the private copy if necessary. The new buffer is allocated
+	// before the old one is released, so the parser remains usable
+	// when the allocation fails.
+	if (!parser->borrowed && size > parser->capacity) {
+		unsigned char *buffer = (unsigned char *) dc_context_alloc (parser->context, size);
+		if (buffer == NULL) {
+			ERROR (parser->context, "Failed to allocate memory.");
+			return DC_STATUS_NOMEMORY;
+		}
+
+		dc_context_release (parser->context, parser->buffer);
+		parser->buffer = buffer;
+		parser->capacity = size;
+	}
+
+	if (!parser->borrowed && size) {
+		memcpy (parser->buffer, data, size);
+		data = parser->buffer;
+	}
+
+	parser->data = size ? data : NULL;
+	parser->size = size;
+
+	return DC_STATUS_SUCCESS;
+}
+
 dc_status_t
 dc_parser_destroy (dc_parser_t *parser)
 {
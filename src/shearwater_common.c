@@ -19,7 +19,7 @@
  * MA 02110-1301 USA
  */
 
-#include <string.h> // memcmp, memcpy
+#include <string.h> // memcmp, memcpy, memset
 #include <stdlib.h> // malloc, free
 
 #include "shearwater_common.h"
@@ -83,6 +83,12 @@ shearwater_common_decompress_lre (unsigned char *data, unsigned int size, dc_buf
 	if (nbits % 9 != 0)
 		return -1;
 
+	// The output is written directly into the buffer. The space for all
+	// remaining values (as single bytes) plus one maximum run is reserved
+	// at once, and committed when more is needed.
+	unsigned char *output = NULL;
+	unsigned int available = 0, used = 0;
+
 	unsigned int offset = 0;
 	while (offset + 9 <= nbits) {
 		// Extract the 9 bit value.
@@ -96,25 +102,37 @@ shearwater_common_decompress_lre (unsigned char *data, unsigned int size, dc_buf
 		// not a run and doesn't need expansion. If the bit is not set,
 		// the value contains the number of zero bytes in the run. A
 		// zero-length run indicates the end of the compressed stream.
-		if (value & 0x100) {
-			// Append the data byte directly.
-			unsigned char c = value & 0xFF;
-			if (!dc_buffer_append (buffer, &c, 1))
-				return -1;
-		} else if (value == 0) {
+		if (value == 0) {
 			// Reached the end of the compressed stream.
 			if (isfinal)
 				*isfinal = 1;
 			break;
+		}
+
+		unsigned int length = (value & 0x100) ? 1 : value;
+		if (used + length > available) {
+			dc_buffer_append_commit (buffer, used);
+			available = (nbits - offset) / 9 + 0xFF;
+			used = 0;
+			output = dc_buffer_append_prepare (buffer, available);
+			if (output == NULL)
+				return -1;
+		}
+
+		if (value & 0x100) {
+			// Append the data byte directly.
+			output[used] = value & 0xFF;
 		} else {
 			// Expand the run with zero bytes.
-			if (!dc_buffer_resize (buffer, dc_buffer_get_size (buffer) + value))
-				return -1;
+			memset (output + used, 0, length);
 		}
+		used += length;
 
 		offset += 9;
 	}
 
+	dc_buffer_append_commit (buffer, used);
+
 	return 0;
 }
 
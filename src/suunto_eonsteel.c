@@ -199,7 +199,12 @@ suunto_eonsteel_receive_ble(suunto_eonsteel_device_t *device, unsigned char data
 	unsigned int nbytes = transferred - CRC_SIZE;
 
 	unsigned int crc = array_uint32_le(buffer + nbytes);
-	unsigned int ccrc = checksum_crc32r(buffer, nbytes);
+	unsigned int ccrc = 0;
+	rc = dc_hdlc_get_checksum(device->iostream, &ccrc);
+	if (rc != DC_STATUS_SUCCESS) {
+		ERROR(device->base.context, "Failed to get the packet checksum.");
+		return rc;
+	}
 	if (crc != ccrc) {
 		ERROR(device->base.context, "Invalid checksum (expected %08x, received %08x).", ccrc, crc);
 		return DC_STATUS_PROTOCOL;
@@ -640,6 +645,9 @@ suunto_eonsteel_device_open(dc_device_t **out, dc_context_t *context, dc_iostrea
 			ERROR (context, "Failed to create the HDLC stream.");
 			goto error_free;
 		}
+
+		// Verify the packet checksums while the packets are received.
+		dc_hdlc_set_checksum (eon->iostream, CHECKSUM_CRC32R, 0xffffffff, 0xffffffff, CRC_SIZE);
 	} else {
 		eon->iostream = iostream;
 	}
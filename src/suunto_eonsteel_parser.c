@@ -285,12 +285,12 @@ static int fill_in_desc_details(suunto_eonsteel_parser_t *eon, struct type_desc
 }
 
 static void
-desc_free (struct type_desc desc[], unsigned int count)
+desc_free (dc_context_t *context, struct type_desc desc[], unsigned int count)
 {
 	for (unsigned int i = 0; i < count; ++i) {
-		free(desc[i].desc);
-		free(desc[i].format);
-		free(desc[i].mod);
+		dc_context_release(context, desc[i].desc);
+		dc_context_release(context, desc[i].format);
+		dc_context_release(context, desc[i].mod);
 	}
 }
 
@@ -318,10 +318,10 @@ static int record_type(suunto_eonsteel_parser_t *eon, unsigned short type, const
 			ERROR(eon->base.context, "Unexpected type description: %.*s", len, name);
 			return -1;
 		}
-		p = (char *) malloc(len-4);
+		p = (char *) dc_context_alloc(eon->base.context, len-4);
 		if (!p) {
 			ERROR(eon->base.context, "out of memory");
-			desc_free(&desc, 1);
+			desc_free(eon->base.context, &desc, 1);
 			return -1;
 		}
 		memcpy(p, name+5, len-5);
@@ -341,8 +341,8 @@ static int record_type(suunto_eonsteel_parser_t *eon, unsigned short type, const
 			break;
 		default:
 			ERROR(eon->base.context, "Unknown type descriptor: %.*s", len, name);
-			desc_free(&desc, 1);
-			free(p);
+			desc_free(eon->base.context, &desc, 1);
+			dc_context_release(eon->base.context, p);
 			return -1;
 		}
 	} while ((name = next) != NULL);
@@ -353,13 +353,13 @@ static int record_type(suunto_eonsteel_parser_t *eon, unsigned short type, const
 			desc.desc ? desc.desc : "",
 			desc.format ? desc.format : "",
 			desc.mod ? desc.mod : "");
-		desc_free(&desc, 1);
+		desc_free(eon->base.context, &desc, 1);
 		return -1;
 	}
 
 	fill_in_desc_details(eon, &desc);
 
-	desc_free(eon->type_desc + type, 1);
+	desc_free(eon->base.context, eon->type_desc + type, 1);
 	eon->type_desc[type] = desc;
 	return 0;
 }
@@ -613,7 +613,7 @@ static void sample_gas_switch_event(struct sample_data *info, unsigned short idx
  *
  * "enum:0=NoFly Time,1=Depth,2=Surface Time,3=..."
  */
-static char *lookup_enum(const struct type_desc *desc, unsigned char value)
+static char *lookup_enum(dc_context_t *context, const struct type_desc *desc, unsigned char value)
 {
 	const char *str = desc->format;
 	unsigned char c;
@@ -657,7 +657,7 @@ static char *lookup_enum(const struct type_desc *desc, unsigned char value)
 		if (n != value)
 			continue;
 
-		ret = (char *)malloc(end - begin + 1);
+		ret = (char *)dc_context_alloc(context, end - begin + 1);
 		if (!ret)
 			break;
 
@@ -674,8 +674,8 @@ static char *lookup_enum(const struct type_desc *desc, unsigned char value)
  */
 static void sample_event_state_type(const struct type_desc *desc, struct sample_data *info, unsigned char type)
 {
-	free(info->state_type);
-	info->state_type = lookup_enum(desc, type);
+	dc_context_release(info->eon->base.context, info->state_type);
+	info->state_type = lookup_enum(info->eon->base.context, desc, type);
 }
 
 static void sample_event_state_value(const struct type_desc *desc, struct sample_data *info, unsigned char value)
@@ -706,8 +706,8 @@ static void sample_event_state_value(const struct type_desc *desc, struct sample
 
 static void sample_event_notify_type(const struct type_desc *desc, struct sample_data *info, unsigned char type)
 {
-	free(info->notify_type);
-	info->notify_type = lookup_enum(desc, type);
+	dc_context_release(info->eon->base.context, info->notify_type);
+	info->notify_type = lookup_enum(info->eon->base.context, desc, type);
 }
 
 static void sample_event_notify_value(const struct type_desc *desc, struct sample_data *info, unsigned char value)
@@ -749,8 +749,8 @@ static void sample_event_notify_value(const struct type_desc *desc, struct sampl
 
 static void sample_event_warning_type(const struct type_desc *desc, struct sample_data *info, unsigned char type)
 {
-	free(info->warning_type);
-	info->warning_type = lookup_enum(desc, type);
+	dc_context_release(info->eon->base.context, info->warning_type);
+	info->warning_type = lookup_enum(info->eon->base.context, desc, type);
 }
 
 static void sample_event_warning_value(const struct type_desc *desc, struct sample_data *info, unsigned char value)
@@ -788,8 +788,8 @@ static void sample_event_warning_value(const struct type_desc *desc, struct samp
 
 static void sample_event_alarm_type(const struct type_desc *desc, struct sample_data *info, unsigned char type)
 {
-	free(info->alarm_type);
-	info->alarm_type = lookup_enum(desc, type);
+	dc_context_release(info->eon->base.context, info->alarm_type);
+	info->alarm_type = lookup_enum(info->eon->base.context, desc, type);
 }
 
 
@@ -823,7 +823,7 @@ static void sample_event_alarm_value(const struct type_desc *desc, struct sample
 static void sample_setpoint_type(const struct type_desc *desc, struct sample_data *info, unsigned char value)
 {
 	dc_sample_value_t sample = {0};
-	char *type = lookup_enum(desc, value);
+	char *type = lookup_enum(info->eon->base.context, desc, value);
 
 	if (!type) {
 		DEBUG(info->eon->base.context, "sample_setpoint_type(%u) did not match anything in %s", value, desc->format);
@@ -838,12 +838,12 @@ static void sample_setpoint_type(const struct type_desc *desc, struct sample_dat
 		sample.setpoint = info->eon->cache.customsetpoint;
 	else {
 		DEBUG(info->eon->base.context, "sample_setpoint_type(%u) unknown type '%s'", value, type);
-		free(type);
+		dc_context_release(info->eon->base.context, type);
 		return;
 	}
 
 	if (info->callback) info->callback(DC_SAMPLE_SETPOINT, &sample, info->userdata);
-	free(type);
+	dc_context_release(info->eon->base.context, type);
 }
 
 // uint32
@@ -1018,10 +1018,10 @@ suunto_eonsteel_parser_samples_foreach(dc_parser_t *abstract, dc_sample_callback
 
 	traverse_data(eon, traverse_samples, &data);
 
-	free(data.state_type);
-	free(data.notify_type);
-	free(data.warning_type);
-	free(data.alarm_type);
+	dc_context_release(eon->base.context, data.state_type);
+	dc_context_release(eon->base.context, data.notify_type);
+	dc_context_release(eon->base.context, data.warning_type);
+	dc_context_release(eon->base.context, data.alarm_type);
 
 	return DC_STATUS_SUCCESS;
 }
@@ -1169,7 +1169,7 @@ static int add_gas_type(suunto_eonsteel_parser_t *eon, const struct type_desc *d
 		return 0;
 
 	eon->cache.ngases = idx+1;
-	name = lookup_enum(desc, type);
+	name = lookup_enum(eon->base.context, desc, type);
 	if (!name)
 		DEBUG(eon->base.context, "Unable to look up gas type %u in %s", type, desc->format);
 	else if (!strcasecmp(name, "Diluent"))
@@ -1187,7 +1187,7 @@ static int add_gas_type(suunto_eonsteel_parser_t *eon, const struct type_desc *d
 
 	eon->cache.initialized |= 1 << DC_FIELD_GASMIX_COUNT;
 	eon->cache.initialized |= 1 << DC_FIELD_TANK_COUNT;
-	free(name);
+	dc_context_release(eon->base.context, name);
 	return 0;
 }
 
@@ -1514,7 +1514,7 @@ suunto_eonsteel_parser_destroy(dc_parser_t *parser)
 {
 	suunto_eonsteel_parser_t *eon = (suunto_eonsteel_parser_t *) parser;
 
-	desc_free(eon->type_desc, MAXTYPE);
+	desc_free(eon->base.context, eon->type_desc, MAXTYPE);
 
 	return DC_STATUS_SUCCESS;
 }
@@ -1528,7 +1528,10 @@ static const dc_parser_vtable_t suunto_eonsteel_parser_vtable = {
 	suunto_eonsteel_parser_get_datetime, /* datetime */
 	suunto_eonsteel_parser_get_field, /* fields */
 	suunto_eonsteel_parser_samples_foreach, /* samples_foreach */
-	suunto_eonsteel_parser_destroy /* destroy */
+	suunto_eonsteel_parser_destroy, /* destroy */
+	NULL, /* samples_read */
+	NULL, /* reset */
+	NULL /* summary */
 };
 
 dc_status_t
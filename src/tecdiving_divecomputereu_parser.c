@@ -49,7 +49,10 @@ static const dc_parser_vtable_t tecdiving_divecomputereu_parser_vtable = {
 	tecdiving_divecomputereu_parser_get_datetime, /* datetime */
 	tecdiving_divecomputereu_parser_get_field, /* fields */
 	tecdiving_divecomputereu_parser_samples_foreach, /* samples_foreach */
-	NULL /* destroy */
+	NULL, /* destroy */
+	NULL, /* samples_read */
+	NULL, /* reset */
+	NULL /* summary */
 };
 
 
@@ -0,0 +1,265 @@
+/*
+ * dsf2csv - A simple tool to convert Divesoft Freedom .dsf files to CSV.
+ *
+ * Columnar binary writer.
+ *
+ * Copyright (C) 2023 Jules
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "column_writer.h"
+
+#define HEADER_FIXED_SIZE 40
+#define DIRECTORY_ENTRY_SIZE 32
+#define INITIAL_ROWS 1024
+
+#define ALIGN(x) (((x) + COLUMN_ALIGNMENT - 1) & ~(size_t)(COLUMN_ALIGNMENT - 1))
+
+enum {
+    COL_TIME,
+    COL_DEPTH,
+    COL_TEMPERATURE,
+    COL_PPO2,
+    COL_CNS,
+    COL_SETPOINT,
+    COL_DECO_TYPE,
+    COL_DECO_TIME,
+    COL_DECO_DEPTH,
+    COL_TTS,
+    COL_GASMIX,
+    COL_BEARING,
+    COL_PPO2_SENSOR,
+    COL_PRESSURE = COL_PPO2_SENSOR + SAMPLE_NSENSORS,
+    NCOLUMNS = COL_PRESSURE + SAMPLE_NTANKS
+};
+
+static const struct {
+    const char *name;
+    column_type_t type;
+} sample_columns[NCOLUMNS] = {
+    {"time_ms",         COLUMN_TYPE_U32},
+    {"depth_m",         COLUMN_TYPE_F32},
+    {"temperature_c",   COLUMN_TYPE_F32},
+    {"ppo2_bar",        COLUMN_TYPE_F32},
+    {"cns",             COLUMN_TYPE_F32},
+    {"setpoint_bar",    COLUMN_TYPE_F32},
+    {"deco_type",       COLUMN_TYPE_U8},
+    {"deco_time_s",     COLUMN_TYPE_U32},
+    {"deco_depth_m",    COLUMN_TYPE_F32},
+    {"tts_s",           COLUMN_TYPE_U32},
+    {"gasmix",          COLUMN_TYPE_U32},
+    {"bearing_deg",     COLUMN_TYPE_U32},
+    {"ppo2_1_bar",      COLUMN_TYPE_F32},
+    {"ppo2_2_bar",      COLUMN_TYPE_F32},
+    {"ppo2_3_bar",      COLUMN_TYPE_F32},
+    {"ppo2_4_bar",      COLUMN_TYPE_F32},
+    {"pressure_1_bar",  COLUMN_TYPE_F32},
+    {"pressure_2_bar",  COLUMN_TYPE_F32},
+    {"pressure_3_bar",  COLUMN_TYPE_F32},
+    {"pressure_4_bar",  COLUMN_TYPE_F32},
+    {"pressure_5_bar",  COLUMN_TYPE_F32},
+    {"pressure_6_bar",  COLUMN_TYPE_F32},
+    {"pressure_7_bar",  COLUMN_TYPE_F32},
+    {"pressure_8_bar",  COLUMN_TYPE_F32},
+    {"pressure_9_bar",  COLUMN_TYPE_F32},
+    {"pressure_10_bar", COLUMN_TYPE_F32},
+    {"pressure_11_bar", COLUMN_TYPE_F32},
+    {"pressure_12_bar", COLUMN_TYPE_F32},
+};
+
+static void store_u16le(unsigned char *p, unsigned int value)
+{
+    p[0] = value & 0xFF;
+    p[1] = (value >> 8) & 0xFF;
+}
+
+static void store_u32le(unsigned char *p, unsigned int value)
+{
+    p[0] = value & 0xFF;
+    p[1] = (value >> 8) & 0xFF;
+    p[2] = (value >> 16) & 0xFF;
+    p[3] = (value >> 24) & 0xFF;
+}
+
+static void store_u64le(unsigned char *p, unsigned long long value)
+{
+    store_u32le(p, (unsigned int)(value & 0xFFFFFFFF));
+    store_u32le(p + 4, (unsigned int)(value >> 32));
+}
+
+static void store_f32le(unsigned char *p, float value)
+{
+    unsigned int bits = 0;
+    memcpy(&bits, &value, sizeof(bits));
+    store_u32le(p, bits);
+}
+
+static unsigned int type_width(column_type_t type)
+{
+    return type == COLUMN_TYPE_U8 ? 1 : 4;
+}
+
+int column_writer_init(column_writer_t *writer)
+{
+    memset(writer, 0, sizeof(*writer));
+
+    for (unsigned int i = 0; i < NCOLUMNS; ++i) {
+        writer->columns[i].name = sample_columns[i].name;
+        writer->columns[i].type = sample_columns[i].type;
+        writer->columns[i].width = type_width(sample_columns[i].type);
+    }
+    writer->ncolumns = NCOLUMNS;
+
+    return 0;
+}
+
+void column_writer_free(column_writer_t *writer)
+{
+    for (unsigned int i = 0; i < writer->ncolumns; ++i) {
+        free(writer->columns[i].data);
+        writer->columns[i].data = NULL;
+    }
+    writer->nrows = 0;
+    writer->capacity = 0;
+}
+
+void column_writer_add_metadata(column_writer_t *writer, const char *key, const char *value)
+{
+    if (writer->nmetadata >= COLUMN_MAX_METADATA) return;
+
+    column_metadata_t *entry = &writer->metadata[writer->nmetadata++];
+    snprintf(entry->key, sizeof(entry->key), "%s", key);
+    snprintf(entry->value, sizeof(entry->value), "%s", value);
+}
+
+// Grow all columns together, so a single row capacity covers them all.
+static int column_writer_reserve(column_writer_t *writer)
+{
+    if (writer->nrows < writer->capacity) {
+        return 0;
+    }
+
+    size_t capacity = writer->capacity ? writer->capacity * 2 : INITIAL_ROWS;
+    for (unsigned int i = 0; i < writer->ncolumns; ++i) {
+        column_t *column = &writer->columns[i];
+        unsigned char *data = (unsigned char *)realloc(column->data, capacity * column->width);
+        if (!data) {
+            writer->error = 1;
+            return -1;
+        }
+        column->data = data;
+    }
+    writer->capacity = capacity;
+
+    return 0;
+}
+
+static void store_optional(column_writer_t *writer, unsigned int index, double value, int present)
+{
+    store_f32le(writer->columns[index].data + writer->nrows * 4, present ? (float)value : NAN);
+}
+
+void column_writer_write_sample(column_writer_t *writer, const sample_data_t *sample)
+{
+    if (!sample->dirty) return;
+
+    if (writer->error || column_writer_reserve(writer) != 0) return;
+
+    size_t row = writer->nrows;
+    store_u32le(writer->columns[COL_TIME].data + row * 4, sample->time);
+    store_optional(writer, COL_DEPTH, sample->depth, sample->depth >= 0.0);
+    store_optional(writer, COL_TEMPERATURE, sample->temperature, sample->temperature > -999.0);
+    store_optional(writer, COL_PPO2, sample->ppo2, sample->ppo2 >= 0.0);
+    store_optional(writer, COL_CNS, sample->cns, sample->cns >= 0.0);
+    store_optional(writer, COL_SETPOINT, sample->setpoint, sample->setpoint >= 0.0);
+    writer->columns[COL_DECO_TYPE].data[row] = (unsigned char)sample->deco_type;
+    store_u32le(writer->columns[COL_DECO_TIME].data + row * 4, sample->deco_time);
+    store_optional(writer, COL_DECO_DEPTH, sample->deco_depth, 1);
+    store_u32le(writer->columns[COL_TTS].data + row * 4, sample->tts);
+    store_u32le(writer->columns[COL_GASMIX].data + row * 4, sample->gasmix);
+    store_u32le(writer->columns[COL_BEARING].data + row * 4, sample->bearing);
+    for (unsigned int i = 0; i < SAMPLE_NSENSORS; ++i) {
+        store_optional(writer, COL_PPO2_SENSOR + i, sample->ppo2_sensor[i], sample->ppo2_sensor[i] >= 0.0);
+    }
+    for (unsigned int i = 0; i < SAMPLE_NTANKS; ++i) {
+        store_optional(writer, COL_PRESSURE + i, sample->pressure[i], sample->pressure[i] >= 0.0);
+    }
+
+    writer->nrows++;
+}
+
+int column_writer_serialize(column_writer_t *writer, char **data, size_t *size)
+{
+    *data = NULL;
+    *size = 0;
+
+    if (writer->error) return -1;
+
+    // Compute the layout.
+    size_t header = HEADER_FIXED_SIZE + writer->ncolumns * DIRECTORY_ENTRY_SIZE;
+    for (unsigned int i = 0; i < writer->nmetadata; ++i) {
+        header += 4 + strlen(writer->metadata[i].key) + strlen(writer->metadata[i].value);
+    }
+    header = ALIGN(header);
+
+    size_t offsets[COLUMN_MAX_COLUMNS];
+    size_t total = header;
+    for (unsigned int i = 0; i < writer->ncolumns; ++i) {
+        offsets[i] = total;
+        total = ALIGN(total + writer->nrows * writer->columns[i].width);
+    }
+
+    unsigned char *buffer = (unsigned char *)calloc(1, total);
+    if (!buffer) {
+        writer->error = 1;
+        return -1;
+    }
+
+    // Fixed header.
+    memcpy(buffer, COLUMN_MAGIC, 8);
+    store_u32le(buffer + 8, COLUMN_VERSION);
+    store_u32le(buffer + 12, (unsigned int)header);
+    store_u64le(buffer + 16, total);
+    store_u64le(buffer + 24, writer->nrows);
+    store_u32le(buffer + 32, writer->ncolumns);
+    store_u32le(buffer + 36, writer->nmetadata);
+
+    // Column directory.
+    unsigned char *p = buffer + HEADER_FIXED_SIZE;
+    for (unsigned int i = 0; i < writer->ncolumns; ++i) {
+        const column_t *column = &writer->columns[i];
+        size_t len = strlen(column->name);
+        memcpy(p, column->name, len < COLUMN_NAME_MAX ? len : COLUMN_NAME_MAX - 1);
+        store_u32le(p + 16, column->type);
+        store_u32le(p + 20, column->width);
+        store_u64le(p + 24, offsets[i]);
+        p += DIRECTORY_ENTRY_SIZE;
+    }
+
+    // Metadata.
+    for (unsigned int i = 0; i < writer->nmetadata; ++i) {
+        size_t keylen = strlen(writer->metadata[i].key);
+        size_t vallen = strlen(writer->metadata[i].value);
+        store_u16le(p, (unsigned int)keylen);
+        store_u16le(p + 2, (unsigned int)vallen);
+        memcpy(p + 4, writer->metadata[i].key, keylen);
+        memcpy(p + 4 + keylen, writer->metadata[i].value, vallen);
+        p += 4 + keylen + vallen;
+    }
+
+    // Column data, already stored little endian.
+    for (unsigned int i = 0; i < writer->ncolumns; ++i) {
+        if (writer->nrows) {
+            memcpy(buffer + offsets[i], writer->columns[i].data, writer->nrows * writer->columns[i].width);
+        }
+    }
+
+    *data = (char *)buffer;
+    *size = total;
+
+    return 0;
+}
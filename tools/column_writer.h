@@ -0,0 +1,97 @@
+/*
+ * dsf2csv - A simple tool to convert Divesoft Freedom .dsf files to CSV.
+ *
+ * Columnar binary writer. Instead of text rows, every sample field is
+ * stored as one typed, fixed width column, so a loader can map the file
+ * and use the columns in place without any parsing.
+ *
+ * Copyright (C) 2023 Jules
+ *
+ * File layout (all integers little endian):
+ *
+ *   0   char[8]  magic "DSFCOL\0\0"
+ *   8   u32      version (1)
+ *   12  u32      offset of the first column (the header size)
+ *   16  u64      total file size
+ *   24  u64      number of rows
+ *   32  u32      number of columns
+ *   36  u32      number of metadata entries
+ *   40           column directory, 32 bytes per column:
+ *                  char[16] name (NUL padded), u32 type, u32 width,
+ *                  u64 offset of the column data
+ *                metadata entries, back to back:
+ *                  u16 key length, u16 value length, key, value
+ *
+ * The column data follows, each column aligned to COLUMN_ALIGNMENT bytes
+ * and holding (rows * width) bytes. Missing floating point values are
+ * stored as NaN, and a missing gasmix or bearing as 0xFFFFFFFF. The deco
+ * columns (deco_type, deco_time_s, deco_depth_m and tts_s) are always
+ * present: without a deco sample, they hold DC_DECO_NDL (0), and zero
+ * times and depth, like in the CSV output. The total file size allows
+ * several dives to be simply concatenated into one stream.
+ */
+
+#ifndef COLUMN_WRITER_H
+#define COLUMN_WRITER_H
+
+#include <stddef.h>
+
+#include "sample_data.h"
+
+#define COLUMN_MAGIC "DSFCOL\0\0"
+#define COLUMN_VERSION 1
+#define COLUMN_ALIGNMENT 64
+#define COLUMN_NAME_MAX 16
+
+#define COLUMN_MAX_COLUMNS 32
+#define COLUMN_MAX_METADATA 16
+#define COLUMN_MAX_KEY 32
+#define COLUMN_MAX_VALUE 64
+
+typedef enum {
+    COLUMN_TYPE_U8 = 1,
+    COLUMN_TYPE_U32 = 2,
+    COLUMN_TYPE_F32 = 3
+} column_type_t;
+
+typedef struct {
+    const char *name;
+    column_type_t type;
+    unsigned int width;
+    unsigned char *data;
+} column_t;
+
+typedef struct {
+    char key[COLUMN_MAX_KEY];
+    char value[COLUMN_MAX_VALUE];
+} column_metadata_t;
+
+typedef struct {
+    column_t columns[COLUMN_MAX_COLUMNS];
+    unsigned int ncolumns;
+    size_t nrows;
+    size_t capacity;
+    column_metadata_t metadata[COLUMN_MAX_METADATA];
+    unsigned int nmetadata;
+    int error;
+} column_writer_t;
+
+// Initialize a writer with the sample columns. Returns zero on success.
+int column_writer_init(column_writer_t *writer);
+
+// Release all column data.
+void column_writer_free(column_writer_t *writer);
+
+// Attach a key/value pair to the file (e.g. a dive summary field).
+// Entries beyond COLUMN_MAX_METADATA are dropped, and overlong keys or
+// values are truncated.
+void column_writer_add_metadata(column_writer_t *writer, const char *key, const char *value);
+
+// Append a row, unless the sample has no data (not dirty).
+void column_writer_write_sample(column_writer_t *writer, const sample_data_t *sample);
+
+// Serialize the columns into a newly allocated buffer, which the caller
+// must free. Returns zero on success.
+int column_writer_serialize(column_writer_t *writer, char **data, size_t *size);
+
+#endif /* COLUMN_WRITER_H */
@@ -0,0 +1,296 @@
+/*
+ * dsf2csv - A simple tool to convert Divesoft Freedom .dsf files to CSV.
+ *
+ * Buffered CSV writer.
+ *
+ * Copyright (C) 2023 Jules
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "libdivecomputer/parser.h"
+
+#include "csv_writer.h"
+
+// Values that don't fit in FIXED_MAX once scaled (or NaN) are left to
+// snprintf, and truncated to FIELD_MAX - 1 characters to stay within
+// CSV_ROW_MAX. Below 2^53, the scaled value is rounded to an integer or
+// a half at worst, which is enough for the rounding below to be exact.
+#define FIXED_MAX 0x1p53
+#define FIELD_MAX 64
+
+static const char digit_pairs[] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+static const unsigned long long powers_of_ten[] = {
+    1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL
+};
+
+// The original columns come first, so existing consumers keep working.
+static const char csv_header[] =
+    "Time,Depth,Temperature,PPO2,CNS,Setpoint,DecoType,DecoTime,DecoDepth,"
+    "TTS,GasMix,Bearing,"
+    "PPO2_1,PPO2_2,PPO2_3,PPO2_4,"
+    "Pressure_1,Pressure_2,Pressure_3,Pressure_4,Pressure_5,Pressure_6,"
+    "Pressure_7,Pressure_8,Pressure_9,Pressure_10,Pressure_11,Pressure_12\n";
+
+// Write the decimal representation of an unsigned integer. Returns the
+// number of characters written.
+static size_t format_uint(char *p, unsigned long long value)
+{
+    char tmp[24];
+    char *end = tmp + sizeof(tmp);
+    char *q = end;
+
+    while (value >= 100) {
+        unsigned int pair = (unsigned int)(value % 100) * 2;
+        value /= 100;
+        *--q = digit_pairs[pair + 1];
+        *--q = digit_pairs[pair];
+    }
+    if (value >= 10) {
+        unsigned int pair = (unsigned int)value * 2;
+        *--q = digit_pairs[pair + 1];
+        *--q = digit_pairs[pair];
+    } else {
+        *--q = (char)('0' + value);
+    }
+
+    size_t len = end - q;
+    memcpy(p, q, len);
+    return len;
+}
+
+// Write a value with a fixed number of decimals (at most 6). The result is
+// identical to "%.<decimals>f": the exact binary value is rounded to the
+// nearest decimal, with exact ties rounded to even.
+static size_t format_fixed(char *p, double value, unsigned int decimals)
+{
+    char *start = p;
+    unsigned long long scale = powers_of_ten[decimals];
+
+    if (!(fabs(value) * scale < FIXED_MAX)) {
+        int n = snprintf(p, FIELD_MAX, "%.*f", (int)decimals, value);
+        if (n < 0) return 0;
+        return n < FIELD_MAX ? (size_t)n : FIELD_MAX - 1;
+    }
+
+    if (signbit(value)) {
+        *p++ = '-';
+        value = -value;
+    }
+
+    double product = value * scale;
+    unsigned long long scaled = (unsigned long long)product;
+    double remainder = product - scaled;
+    if (remainder > 0.5) {
+        scaled++;
+    } else if (remainder == 0.5) {
+        // The rounded product is a tie, so the rounding error of the
+        // multiplication decides which way the exact value goes.
+        double error = fma(value, (double)scale, -product);
+        if (error > 0.0 || (error == 0.0 && (scaled & 1))) {
+            scaled++;
+        }
+    }
+
+    p += format_uint(p, scaled / scale);
+
+    if (decimals) {
+        unsigned long long fraction = scaled % scale;
+        *p++ = '.';
+        for (unsigned int i = decimals; i > 0; --i) {
+            p[i - 1] = (char)('0' + fraction % 10);
+            fraction /= 10;
+        }
+        p += decimals;
+    }
+
+    return p - start;
+}
+
+static size_t append_string(char *p, const char *str, size_t len)
+{
+    memcpy(p, str, len);
+    return len;
+}
+
+int csv_writer_init(csv_writer_t *writer, FILE *outfile, size_t capacity)
+{
+    if (capacity < CSV_ROW_MAX) {
+        capacity = CSV_WRITER_BUFSIZE;
+    }
+
+    writer->outfile = outfile;
+    writer->length = 0;
+    writer->capacity = capacity;
+    writer->error = 0;
+    writer->buffer = (char *)malloc(capacity);
+    if (!writer->buffer) {
+        writer->capacity = 0;
+        writer->error = 1;
+        return -1;
+    }
+
+    return 0;
+}
+
+// Make room for at least size bytes, by flushing the buffer to the output
+// file, or by growing it for an in-memory writer.
+static int csv_writer_reserve(csv_writer_t *writer, size_t size)
+{
+    if (writer->capacity - writer->length >= size) {
+        return 0;
+    }
+
+    if (writer->outfile) {
+        csv_writer_flush(writer);
+        if (writer->capacity >= size) {
+            return 0;
+        }
+    }
+
+    size_t capacity = writer->capacity ? writer->capacity * 2 : CSV_WRITER_BUFSIZE;
+    while (capacity - writer->length < size) {
+        capacity *= 2;
+    }
+
+    char *buffer = (char *)realloc(writer->buffer, capacity);
+    if (!buffer) {
+        writer->error = 1;
+        return -1;
+    }
+
+    writer->buffer = buffer;
+    writer->capacity = capacity;
+    return 0;
+}
+
+int csv_writer_flush(csv_writer_t *writer)
+{
+    if (!writer->outfile) {
+        return writer->error ? -1 : 0;
+    }
+
+    if (writer->length && !writer->error) {
+        if (fwrite(writer->buffer, 1, writer->length, writer->outfile) != writer->length) {
+            writer->error = 1;
+        }
+    }
+    writer->length = 0;
+
+    return writer->error ? -1 : 0;
+}
+
+char *csv_writer_release(csv_writer_t *writer, size_t *size)
+{
+    char *buffer = writer->buffer;
+    *size = writer->length;
+
+    writer->buffer = NULL;
+    writer->length = 0;
+    writer->capacity = 0;
+
+    return buffer;
+}
+
+int csv_writer_finish(csv_writer_t *writer)
+{
+    csv_writer_flush(writer);
+
+    free(writer->buffer);
+    writer->buffer = NULL;
+    writer->capacity = 0;
+
+    return writer->error ? -1 : 0;
+}
+
+void csv_writer_write_header(csv_writer_t *writer)
+{
+    csv_writer_write(writer, csv_header, sizeof(csv_header) - 1);
+}
+
+void csv_writer_write(csv_writer_t *writer, const void *data, size_t size)
+{
+    if (csv_writer_reserve(writer, size) != 0) return;
+
+    writer->length += append_string(writer->buffer + writer->length, (const char *)data, size);
+}
+
+void csv_writer_write_sample(csv_writer_t *writer, const sample_data_t *sample)
+{
+    if (!sample->dirty) return;
+
+    if (csv_writer_reserve(writer, CSV_ROW_MAX) != 0) return;
+
+    writer->length += csv_format_sample(writer->buffer + writer->length, sample);
+}
+
+size_t csv_format_sample(char *buffer, const sample_data_t *sample)
+{
+    char *p = buffer;
+
+    p += format_uint(p, sample->time / 1000);
+    *p++ = ',';
+
+    if (sample->depth >= 0.0) p += format_fixed(p, sample->depth, 2);
+    *p++ = ',';
+
+    if (sample->temperature > -999.0) p += format_fixed(p, sample->temperature, 1);
+    *p++ = ',';
+
+    if (sample->ppo2 >= 0.0) p += format_fixed(p, sample->ppo2, 2);
+    *p++ = ',';
+
+    if (sample->cns >= 0.0) p += format_fixed(p, sample->cns, 2);
+    *p++ = ',';
+
+    if (sample->setpoint >= 0.0) p += format_fixed(p, sample->setpoint, 2);
+    *p++ = ',';
+
+    if (sample->deco_type == DC_DECO_DECOSTOP) {
+        p += append_string(p, "DECOSTOP,", 9);
+    } else if (sample->deco_type == DC_DECO_SAFETYSTOP) {
+        p += append_string(p, "SAFETYSTOP,", 11);
+    } else {
+        p += append_string(p, "NDL,", 4);
+    }
+
+    p += format_uint(p, sample->deco_time);
+    *p++ = ',';
+    p += format_fixed(p, sample->deco_depth, 2);
+    *p++ = ',';
+
+    p += format_uint(p, sample->tts);
+    *p++ = ',';
+
+    if (sample->gasmix != SAMPLE_UNDEFINED) p += format_uint(p, sample->gasmix);
+    *p++ = ',';
+
+    if (sample->bearing != SAMPLE_UNDEFINED) p += format_uint(p, sample->bearing);
+
+    for (unsigned int i = 0; i < SAMPLE_NSENSORS; ++i) {
+        *p++ = ',';
+        if (sample->ppo2_sensor[i] >= 0.0) p += format_fixed(p, sample->ppo2_sensor[i], 2);
+    }
+
+    for (unsigned int i = 0; i < SAMPLE_NTANKS; ++i) {
+        *p++ = ',';
+        if (sample->pressure[i] >= 0.0) p += format_fixed(p, sample->pressure[i], 1);
+    }
+    *p++ = '\n';
+
+    return p - buffer;
+}
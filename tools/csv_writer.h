@@ -0,0 +1,62 @@
+/*
+ * dsf2csv - A simple tool to convert Divesoft Freedom .dsf files to CSV.
+ *
+ * Buffered CSV writer. Rows are formatted with a small integer-to-decimal
+ * routine into one large reusable buffer, which is flushed to the output
+ * file in big blocks. This avoids the format string parsing and locale
+ * handling of fprintf for every field.
+ *
+ * Copyright (C) 2023 Jules
+ */
+
+#ifndef CSV_WRITER_H
+#define CSV_WRITER_H
+
+#include <stdio.h>
+
+#include "sample_data.h"
+
+#define CSV_WRITER_BUFSIZE (256 * 1024)
+
+// The maximum length of a single formatted row, including the newline.
+#define CSV_ROW_MAX 2048
+
+
+typedef struct {
+    FILE *outfile;
+    char *buffer;
+    size_t length;
+    size_t capacity;
+    int error;
+} csv_writer_t;
+
+// Initialize a writer for the given output file. A capacity of zero
+// selects the default buffer size. Without an output file, the writer
+// collects everything in memory (see csv_writer_release). Returns zero
+// on success.
+int csv_writer_init(csv_writer_t *writer, FILE *outfile, size_t capacity);
+
+// Write out all buffered data. Returns zero on success.
+int csv_writer_flush(csv_writer_t *writer);
+
+// Take ownership of the data collected by an in-memory writer. The
+// caller must free the returned buffer.
+char *csv_writer_release(csv_writer_t *writer, size_t *size);
+
+// Flush the remaining data and release the buffer. The output file is
+// not closed. Returns zero if all data was written successfully.
+int csv_writer_finish(csv_writer_t *writer);
+
+void csv_writer_write_header(csv_writer_t *writer);
+
+// Append raw bytes (e.g. a record separator).
+void csv_writer_write(csv_writer_t *writer, const void *data, size_t size);
+
+// Append a row, unless the sample has no data (not dirty).
+void csv_writer_write_sample(csv_writer_t *writer, const sample_data_t *sample);
+
+// Format a row into the buffer, which must have room for CSV_ROW_MAX
+// bytes. Returns the number of bytes written.
+size_t csv_format_sample(char *buffer, const sample_data_t *sample);
+
+#endif /* CSV_WRITER_H */
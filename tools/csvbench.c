@@ -0,0 +1,335 @@
+/*
+ * csvbench - Benchmark for the dsf2csv CSV writer.
+ *
+ * Parses a dive log once, and then formats its sample rows repeatedly,
+ * both with the original fprintf based row writer and with the buffered
+ * CSV writer, reporting the number of rows per second for each.
+ *
+ * Copyright (C) 2023 Jules
+ *
+ * Usage: ./csvbench [-n rows] <input.dsf>
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+#include "libdivecomputer/context.h"
+#include "libdivecomputer/parser.h"
+
+#include "csv_writer.h"
+
+#ifdef _WIN32
+#define NULL_DEVICE "NUL"
+#else
+#define NULL_DEVICE "/dev/null"
+#endif
+
+#define DEFAULT_ROWS 2000000
+
+// The number of samples fetched from the parser at once.
+#define SAMPLE_BATCH 1024
+
+typedef struct {
+    sample_data_t *rows;
+    size_t count;
+    size_t capacity;
+    sample_data_t current;
+} row_list_t;
+
+static double monotonic_seconds(void);
+static dc_status_t load_rows(const char *filename, row_list_t *list);
+static void collect_callback(dc_sample_type_t type, const dc_sample_value_t *value, void *userdata);
+static int append_row(row_list_t *list);
+static void write_sample_fprintf(FILE *outfile, const sample_data_t *sample);
+static int compare_outputs(const row_list_t *list);
+static double bench_fprintf(const row_list_t *list, size_t iterations);
+static double bench_writer(const row_list_t *list, size_t iterations);
+
+int main(int argc, char *argv[])
+{
+    unsigned long long nrows = DEFAULT_ROWS;
+
+    int opt = 0;
+    while ((opt = getopt(argc, argv, "hn:")) != -1) {
+        switch (opt) {
+        case 'n':
+            nrows = strtoull(optarg, NULL, 0);
+            break;
+        case 'h':
+        default:
+            fprintf(stderr, "Usage: %s [-n rows] <input.dsf>\n", argv[0]);
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+
+    if (optind + 1 != argc) {
+        fprintf(stderr, "Usage: %s [-n rows] <input.dsf>\n", argv[0]);
+        return 1;
+    }
+
+    row_list_t list = {NULL, 0, 0, {0}};
+    if (load_rows(argv[optind], &list) != DC_STATUS_SUCCESS) {
+        free(list.rows);
+        return 1;
+    }
+
+    if (list.count == 0) {
+        fprintf(stderr, "Error: No sample rows in '%s'.\n", argv[optind]);
+        free(list.rows);
+        return 1;
+    }
+
+    // Repeat the dive until the requested number of rows is reached.
+    size_t iterations = (size_t)((nrows + list.count - 1) / list.count);
+    if (iterations == 0) iterations = 1;
+
+    printf("Input: %s (%zu rows per dive, %zu iterations)\n", argv[optind], list.count, iterations);
+    printf("Output identical: %s\n", compare_outputs(&list) == 0 ? "yes" : "NO");
+
+    double total = (double)list.count * iterations;
+    double t_fprintf = bench_fprintf(&list, iterations);
+    double t_writer = bench_writer(&list, iterations);
+
+    printf("fprintf:    %.0f rows in %.3f s (%.0f rows/s)\n", total, t_fprintf, t_fprintf > 0.0 ? total / t_fprintf : 0.0);
+    printf("csv_writer: %.0f rows in %.3f s (%.0f rows/s)\n", total, t_writer, t_writer > 0.0 ? total / t_writer : 0.0);
+    if (t_writer > 0.0) {
+        printf("Speedup: %.2fx\n", t_fprintf / t_writer);
+    }
+
+    free(list.rows);
+
+    return 0;
+}
+
+static double monotonic_seconds(void)
+{
+#if defined(HAVE_CLOCK_GETTIME) && defined(CLOCK_MONOTONIC)
+    struct timespec ts;
+    if (clock_gettime(CLOCK_MONOTONIC, &ts) == 0) {
+        return ts.tv_sec + ts.tv_nsec / 1e9;
+    }
+#endif
+    return (double)clock() / CLOCKS_PER_SEC;
+}
+
+static dc_status_t load_rows(const char *filename, row_list_t *list)
+{
+    FILE *file = fopen(filename, "rb");
+    if (!file) {
+        fprintf(stderr, "Error: Cannot open file '%s'.\n", filename);
+        return DC_STATUS_IO;
+    }
+
+    unsigned char *buffer = NULL;
+    size_t size = 0, capacity = 0, n = 0;
+    do {
+        if (size == capacity) {
+            capacity = capacity ? capacity * 2 : 65536;
+            unsigned char *tmp = (unsigned char *)realloc(buffer, capacity);
+            if (!tmp) {
+                fprintf(stderr, "Error: Cannot allocate memory to read file.\n");
+                free(buffer);
+                fclose(file);
+                return DC_STATUS_NOMEMORY;
+            }
+            buffer = tmp;
+        }
+        n = fread(buffer + size, 1, capacity - size, file);
+        size += n;
+    } while (n);
+    fclose(file);
+
+    dc_context_t *context = NULL;
+    dc_status_t status = dc_context_new(&context);
+    if (status != DC_STATUS_SUCCESS) {
+        free(buffer);
+        return status;
+    }
+    dc_context_set_loglevel(context, DC_LOGLEVEL_ERROR);
+
+    dc_iterator_t *iter = NULL;
+    dc_descriptor_t *descriptor = NULL;
+    dc_descriptor_iterator_new(&iter, context);
+    while (dc_iterator_next(iter, &descriptor) == DC_STATUS_SUCCESS) {
+        if (strcmp(dc_descriptor_get_vendor(descriptor), "Divesoft") == 0 &&
+            strcmp(dc_descriptor_get_product(descriptor), "Freedom") == 0) {
+            break;
+        }
+        dc_descriptor_free(descriptor);
+        descriptor = NULL;
+    }
+    dc_iterator_free(iter);
+
+    dc_parser_t *parser = NULL;
+    status = dc_parser_new2_borrowed(&parser, context, descriptor, buffer, size);
+    dc_descriptor_free(descriptor);
+    if (status == DC_STATUS_SUCCESS) {
+        sample_data_reset(&list->current);
+        // Sample errors are ignored; the rows decoded so far are used.
+        dc_sample_t samples[SAMPLE_BATCH];
+        unsigned int count = 0;
+        do {
+            dc_status_t rc = dc_parser_samples_read(parser, samples, SAMPLE_BATCH, &count);
+            for (unsigned int i = 0; i < count; ++i) {
+                collect_callback(samples[i].type, &samples[i].value, list);
+            }
+            if (rc != DC_STATUS_SUCCESS) break;
+        } while (count);
+        append_row(list);
+        dc_parser_destroy(parser);
+    } else {
+        fprintf(stderr, "Error: Failed to create parser (code: %d).\n", status);
+    }
+
+    free(buffer);
+    dc_context_free(context);
+
+    return status;
+}
+
+static int append_row(row_list_t *list)
+{
+    if (!list->current.dirty) return 0;
+
+    if (list->count == list->capacity) {
+        size_t capacity = list->capacity ? list->capacity * 2 : 1024;
+        sample_data_t *rows = (sample_data_t *)realloc(list->rows, capacity * sizeof(sample_data_t));
+        if (!rows) return -1;
+        list->rows = rows;
+        list->capacity = capacity;
+    }
+
+    list->rows[list->count++] = list->current;
+    return 0;
+}
+
+static void collect_callback(dc_sample_type_t type, const dc_sample_value_t *value, void *userdata)
+{
+    row_list_t *list = (row_list_t *)userdata;
+
+    if (type == DC_SAMPLE_TIME) {
+        append_row(list);
+        sample_data_reset(&list->current);
+    }
+
+    sample_data_update(&list->current, type, value);
+}
+
+// The original dsf2csv row writer, kept as the baseline.
+static void write_sample_fprintf(FILE *outfile, const sample_data_t *sample)
+{
+    if (!sample->dirty) return;
+
+    fprintf(outfile, "%u,", sample->time / 1000);
+
+    if (sample->depth >= 0.0) fprintf(outfile, "%.2f", sample->depth);
+    fprintf(outfile, ",");
+
+    if (sample->temperature > -999.0) fprintf(outfile, "%.1f", sample->temperature);
+    fprintf(outfile, ",");
+
+    if (sample->ppo2 >= 0.0) fprintf(outfile, "%.2f", sample->ppo2);
+    fprintf(outfile, ",");
+
+    if (sample->cns >= 0.0) fprintf(outfile, "%.2f", sample->cns);
+    fprintf(outfile, ",");
+
+    if (sample->setpoint >= 0.0) fprintf(outfile, "%.2f", sample->setpoint);
+    fprintf(outfile, ",");
+
+    const char *deco_type_str = "NDL";
+    if (sample->deco_type == DC_DECO_DECOSTOP) deco_type_str = "DECOSTOP";
+    else if (sample->deco_type == DC_DECO_SAFETYSTOP) deco_type_str = "SAFETYSTOP";
+    fprintf(outfile, "%s,%u,%.2f,", deco_type_str, sample->deco_time, sample->deco_depth);
+
+    fprintf(outfile, "%u,", sample->tts);
+    if (sample->gasmix != SAMPLE_UNDEFINED) fprintf(outfile, "%u", sample->gasmix);
+    fprintf(outfile, ",");
+    if (sample->bearing != SAMPLE_UNDEFINED) fprintf(outfile, "%u", sample->bearing);
+
+    for (unsigned int i = 0; i < SAMPLE_NSENSORS; ++i) {
+        fprintf(outfile, ",");
+        if (sample->ppo2_sensor[i] >= 0.0) fprintf(outfile, "%.2f", sample->ppo2_sensor[i]);
+    }
+
+    for (unsigned int i = 0; i < SAMPLE_NTANKS; ++i) {
+        fprintf(outfile, ",");
+        if (sample->pressure[i] >= 0.0) fprintf(outfile, "%.1f", sample->pressure[i]);
+    }
+    fprintf(outfile, "\n");
+}
+
+static int compare_outputs(const row_list_t *list)
+{
+    char expected[CSV_ROW_MAX * 2];
+    char actual[CSV_ROW_MAX];
+
+    for (size_t i = 0; i < list->count; ++i) {
+        FILE *fp = tmpfile();
+        if (!fp) return -1;
+        write_sample_fprintf(fp, &list->rows[i]);
+        rewind(fp);
+        size_t n = fread(expected, 1, sizeof(expected), fp);
+        fclose(fp);
+
+        size_t m = csv_format_sample(actual, &list->rows[i]);
+        if (n != m || memcmp(expected, actual, n) != 0) {
+            fprintf(stderr, "Row %zu differs:\n  %.*s  %.*s", i, (int)n, expected, (int)m, actual);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+static double bench_fprintf(const row_list_t *list, size_t iterations)
+{
+    FILE *fp = fopen(NULL_DEVICE, "w");
+    if (!fp) return 0.0;
+
+    double start = monotonic_seconds();
+    for (size_t n = 0; n < iterations; ++n) {
+        for (size_t i = 0; i < list->count; ++i) {
+            write_sample_fprintf(fp, &list->rows[i]);
+        }
+    }
+    fflush(fp);
+    double elapsed = monotonic_seconds() - start;
+
+    fclose(fp);
+    return elapsed;
+}
+
+static double bench_writer(const row_list_t *list, size_t iterations)
+{
+    FILE *fp = fopen(NULL_DEVICE, "w");
+    if (!fp) return 0.0;
+
+    csv_writer_t writer;
+    if (csv_writer_init(&writer, fp, 0) != 0) {
+        fclose(fp);
+        return 0.0;
+    }
+
+    double start = monotonic_seconds();
+    for (size_t n = 0; n < iterations; ++n) {
+        for (size_t i = 0; i < list->count; ++i) {
+            csv_writer_write_sample(&writer, &list->rows[i]);
+        }
+    }
+    csv_writer_flush(&writer);
+    double elapsed = monotonic_seconds() - start;
+
+    csv_writer_finish(&writer);
+    fclose(fp);
+    return elapsed;
+}
@@ -2,84 +2,777 @@
  * dsf2csv - A simple tool to convert Divesoft Freedom .dsf files to CSV.
  *
  * This tool is a minimalist utility based on libdivecomputer.
- * It reads a .dsf file and outputs its dive data as a CSV file.
+ * It reads one or more .dsf files and outputs their dive data as CSV files,
+ * or as columnar binary files (see column_writer.h).
  *
  * Copyright (C) 2023 Jules
  *
- * Usage: ./dsf2csv <input.dsf>
+ * Usage: ./dsf2csv [-j jobs] [-f format] [-o output] [-z] [-c] [-t] <input>...
  */
 
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#ifdef HAVE_GETOPT_H
+#include <getopt.h>
+#endif
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
+#ifdef HAVE_DIRENT_H
+#include <dirent.h>
+#endif
+#ifdef HAVE_GLOB_H
+#include <glob.h>
+#endif
+#if defined(HAVE_SYS_MMAN_H) && defined(HAVE_MMAP)
+#define USE_MMAP
+#include <sys/mman.h>
+#include <fcntl.h>
+#endif
 
 #include "libdivecomputer/context.h"
 #include "libdivecomputer/parser.h"
+#include "libdivecomputer/divesoft_freedom.h"
 #include "libdivecomputer/version.h"
 
-// A struct to hold all the data for a single row in the CSV.
-typedef struct {
-    unsigned int time;
-    double depth;
-    double temperature;
-    double ppo2;
-    double cns;
-    double setpoint;
-    // Separate fields for deco info, since dc_deco_t is not a real type
-    unsigned int deco_type;
-    unsigned int deco_time;
-    double deco_depth;
-    int dirty; // Flag to check if we have data to write
-} sample_data_t;
-
-// A struct to pass necessary data to the callback function.
+#include "csv_writer.h"
+#include "column_writer.h"
+
+#define MAX_JOBS 64
+
+// The initial buffer size for input that can't be seeked.
+#define READ_CHUNK (64 * 1024)
+
+typedef enum {
+    OUTPUT_CSV,
+    OUTPUT_COLUMNAR
+} output_format_t;
+
+// A struct to pass necessary data to the callback function. Exactly one
+// of the writers is set.
 typedef struct {
-    FILE *outfile;
+    csv_writer_t *writer;
+    column_writer_t *columns;
     sample_data_t *current_sample;
+    unsigned int nsamples;
 } callback_userdata_t;
 
+// The outcome of converting a single input file. Workers fill these in,
+// and the main thread reports them in input order once everything is done.
+typedef struct {
+    char *input_filename;
+    char *output_filename; // NULL when streaming to a shared output
+    dc_status_t status;
+    int have_datetime;
+    dc_datetime_t datetime;
+    int have_maxdepth;
+    double max_depth;
+    int have_divetime;
+    unsigned int divetime;
+    unsigned int nsamples;
+    // The parts of the dive that were skipped in tolerant mode.
+    divesoft_freedom_range_t *skipped;
+    unsigned int nskipped;
+    // The data of a streamed dive that is waiting for its turn.
+    char *output;
+    size_t output_size;
+    int done;
+} conversion_job_t;
+
+// An input file, either memory mapped or read into a heap buffer. The
+// parser borrows the data, so it must stay valid until it is destroyed.
+typedef struct {
+    const unsigned char *data;
+    size_t size;
+    void *mapping;
+    unsigned char *buffer;
+} input_file_t;
+
+// A growable list of input filenames.
+typedef struct {
+    char **items;
+    size_t count;
+    size_t capacity;
+} filename_list_t;
+
+// The shared work queue. Workers take the next unclaimed job.
+//
+// When all dives go to a single output stream, a lone worker writes them
+// directly in input order. Multiple workers collect each dive in memory
+// instead, and the dives are written to the stream in input order as soon
+// as all the preceding ones are done.
+typedef struct {
+    conversion_job_t *jobs;
+    size_t njobs;
+    size_t next;
+    int use_mmap;
+    output_format_t format;
+    FILE *stream;
+    const char *stream_name;
+    int capture;
+    int separator;
+    int check; // Only validate the input files.
+    int tolerant; // Skip damaged records instead of failing.
+    size_t next_output;
+    int stream_error;
+#ifdef HAVE_PTHREAD_H
+    pthread_mutex_t lock;
+#endif
+} job_queue_t;
+
 // Forward declarations
 static void show_help(void);
-static dc_status_t read_file_into_buffer(const char *filename, unsigned char **buffer, size_t *size);
+static unsigned int default_job_count(void);
+static double monotonic_seconds(void);
+static int filename_list_add(filename_list_t *list, const char *filename);
+static void filename_list_free(filename_list_t *list);
+static int collect_inputs(filename_list_t *list, const char *argument);
+static int collect_stdin(filename_list_t *list);
+static int collect_directory(filename_list_t *list, const char *dirname);
+static int collect_glob(filename_list_t *list, const char *pattern);
+static int has_log_extension(const char *filename);
+static int compare_filenames(const void *a, const void *b);
+static char *derive_output_filename(const char *input_filename, const char *extension);
+static void reject_duplicate_outputs(conversion_job_t *jobs, size_t njobs);
+static conversion_job_t *job_queue_next(job_queue_t *queue);
+static void job_queue_complete(job_queue_t *queue, conversion_job_t *job);
+static void job_queue_write_ready(job_queue_t *queue);
+static void *worker_main(void *arg);
+static dc_descriptor_t *find_descriptor(dc_context_t *context);
+static dc_status_t collect_skipped(conversion_job_t *job, dc_parser_t *parser);
+static dc_status_t convert_file(conversion_job_t *job, dc_parser_t **parser, dc_context_t *context, dc_descriptor_t *descriptor, job_queue_t *queue);
+static dc_status_t write_csv(conversion_job_t *job, dc_parser_t *parser, job_queue_t *queue);
+static dc_status_t write_columnar(conversion_job_t *job, dc_parser_t *parser, const dc_summary_t *summary, job_queue_t *queue);
+static void add_dive_metadata(column_writer_t *columns, const conversion_job_t *job, const dc_summary_t *summary);
+static dc_status_t write_output(const conversion_job_t *job, job_queue_t *queue, const char *data, size_t size);
+static const char *skip_reason(unsigned int reason);
+static void report_skipped(const conversion_job_t *job);
+static void report_job(const conversion_job_t *job, const job_queue_t *queue);
+static dc_status_t open_input_file(const char *filename, input_file_t *input, int use_mmap);
+static void close_input_file(input_file_t *input);
+static dc_status_t read_file_into_buffer(FILE *file, const char *filename, unsigned char **buffer, size_t *size);
 static void sample_callback(dc_sample_type_t type, const dc_sample_value_t *value, void *userdata);
-static void write_sample_to_csv(FILE *outfile, sample_data_t *sample);
-static void reset_sample_data(sample_data_t *sample);
+static void write_sample(callback_userdata_t *data, const sample_data_t *sample);
 
 int main(int argc, char *argv[])
 {
     // --- Argument Parsing ---
-    if (argc != 2) {
+    unsigned int njobs = 0;
+    int use_mmap = 1;
+    output_format_t format = OUTPUT_CSV;
+    const char *output = NULL;
+    int separator = 0;
+    int check = 0;
+    int tolerant = 0;
+
+    int opt = 0;
+    const char *optstring = "hj:Mf:o:zct";
+#ifdef HAVE_GETOPT_LONG
+    struct option options[] = {
+        {"help",    no_argument,       0, 'h'},
+        {"jobs",    required_argument, 0, 'j'},
+        {"no-mmap", no_argument,       0, 'M'},
+        {"format",  required_argument, 0, 'f'},
+        {"output",  required_argument, 0, 'o'},
+        {"null",    no_argument,       0, 'z'},
+        {"check",   no_argument,       0, 'c'},
+        {"tolerant", no_argument,      0, 't'},
+        {0,         0,                 0,  0 }
+    };
+    while ((opt = getopt_long(argc, argv, optstring, options, NULL)) != -1) {
+#else
+    while ((opt = getopt(argc, argv, optstring)) != -1) {
+#endif
+        switch (opt) {
+        case 'h':
+            show_help();
+            return 0;
+        case 'j':
+            njobs = strtoul(optarg, NULL, 0);
+            if (njobs == 0 || njobs > MAX_JOBS) {
+                fprintf(stderr, "Error: The number of jobs must be between 1 and %u.\n", MAX_JOBS);
+                return 1;
+            }
+            break;
+        case 'M':
+            use_mmap = 0;
+            break;
+        case 'f':
+            if (strcmp(optarg, "csv") == 0) {
+                format = OUTPUT_CSV;
+            } else if (strcmp(optarg, "columnar") == 0) {
+                format = OUTPUT_COLUMNAR;
+            } else {
+                fprintf(stderr, "Error: Unknown output format '%s'.\n", optarg);
+                return 1;
+            }
+            break;
+        case 'o':
+            output = optarg;
+            break;
+        case 'z':
+            separator = 1;
+            break;
+        case 'c':
+            check = 1;
+            break;
+        case 't':
+            tolerant = 1;
+            break;
+        default:
+            show_help();
+            return 1;
+        }
+    }
+
+    if (optind >= argc) {
         show_help();
         return 1;
     }
 
-    if (strcmp(argv[1], "--help") == 0 || strcmp(argv[1], "-h") == 0) {
-        show_help();
-        return 0;
+    if (separator && format != OUTPUT_CSV) {
+        fprintf(stderr, "Error: The -z option only applies to CSV output.\n");
+        return 1;
+    }
+
+    if (check && (output || separator)) {
+        fprintf(stderr, "Error: The -c option does not write any output.\n");
+        return 1;
+    }
+
+    // --- Collect the input files ---
+    filename_list_t inputs = {NULL, 0, 0};
+    for (int i = optind; i < argc; ++i) {
+        if (collect_inputs(&inputs, argv[i]) != 0) {
+            filename_list_free(&inputs);
+            return 1;
+        }
+    }
+
+    if (inputs.count == 0) {
+        fprintf(stderr, "Error: No input files found.\n");
+        filename_list_free(&inputs);
+        return 1;
+    }
+
+    conversion_job_t *jobs = (conversion_job_t *)calloc(inputs.count, sizeof(conversion_job_t));
+    if (!jobs) {
+        fprintf(stderr, "Error: Cannot allocate memory for %zu jobs.\n", inputs.count);
+        filename_list_free(&inputs);
+        return 1;
+    }
+
+    // --- Open the shared output stream ---
+    FILE *stream = NULL;
+    if (output && strcmp(output, "-") == 0) {
+        stream = stdout;
+        output = "stdout";
+    } else if (output) {
+        stream = fopen(output, "wb");
+        if (!stream) {
+            fprintf(stderr, "Error: Could not open output file %s\n", output);
+            free(jobs);
+            filename_list_free(&inputs);
+            return 1;
+        }
+    }
+
+    for (size_t i = 0; i < inputs.count; ++i) {
+        jobs[i].input_filename = inputs.items[i];
+        jobs[i].status = DC_STATUS_SUCCESS;
+        if (stream == NULL && !check) {
+            jobs[i].output_filename = derive_output_filename(inputs.items[i],
+                format == OUTPUT_COLUMNAR ? ".dsfc" : ".csv");
+            if (jobs[i].output_filename == NULL) {
+                fprintf(stderr, "Error: Cannot allocate memory for the output filename.\n");
+                jobs[i].status = DC_STATUS_NOMEMORY;
+            }
+        }
+    }
+
+    if (stream == NULL && !check) {
+        reject_duplicate_outputs(jobs, inputs.count);
+    }
+
+    // --- Run the workers ---
+    if (njobs == 0) {
+        njobs = default_job_count();
+    }
+    if (njobs > inputs.count) {
+        njobs = inputs.count;
+    }
+
+    job_queue_t queue;
+    queue.jobs = jobs;
+    queue.njobs = inputs.count;
+    queue.next = 0;
+    queue.use_mmap = use_mmap;
+    queue.format = format;
+    queue.stream = stream;
+    queue.stream_name = output;
+    queue.capture = stream != NULL && njobs > 1;
+    queue.separator = separator;
+    queue.check = check;
+    queue.tolerant = tolerant;
+    queue.next_output = 0;
+    queue.stream_error = 0;
+
+    double start = monotonic_seconds();
+
+#ifdef HAVE_PTHREAD_H
+    pthread_mutex_init(&queue.lock, NULL);
+
+    pthread_t threads[MAX_JOBS];
+    unsigned int nthreads = 0;
+    for (unsigned int i = 1; i < njobs; ++i) {
+        if (pthread_create(&threads[nthreads], NULL, worker_main, &queue) != 0) {
+            fprintf(stderr, "Warning: Failed to start worker thread %u.\n", i);
+            break;
+        }
+        nthreads++;
+    }
+
+    // The main thread is a worker too.
+    worker_main(&queue);
+
+    for (unsigned int i = 0; i < nthreads; ++i) {
+        pthread_join(threads[i], NULL);
+    }
+
+    pthread_mutex_destroy(&queue.lock);
+#else
+    worker_main(&queue);
+#endif
+
+    // Write out the dives that were skipped at the end of the queue.
+    job_queue_write_ready(&queue);
+
+    if (stream) {
+        if (fflush(stream) != 0 || ferror(stream)) {
+            queue.stream_error = 1;
+        }
+        if (stream != stdout && fclose(stream) != 0) {
+            queue.stream_error = 1;
+        }
+        if (queue.stream_error) {
+            fprintf(stderr, "Error: Failed to write to %s\n", output);
+        }
+    }
+
+    double elapsed = monotonic_seconds() - start;
+
+    // --- Report the results in input order ---
+    // All status messages go to stderr, so stdout can carry the CSV data.
+    size_t nfailed = 0;
+    unsigned long long nsamples = 0;
+    for (size_t i = 0; i < inputs.count; ++i) {
+        report_job(&jobs[i], &queue);
+        if (jobs[i].status != DC_STATUS_SUCCESS) {
+            nfailed++;
+        } else {
+            nsamples += jobs[i].nsamples;
+        }
+    }
+
+    if (check) {
+        fprintf(stderr, "\nChecked %zu files: %zu valid, %zu invalid in %.3f s.\n",
+                inputs.count, inputs.count - nfailed, nfailed, elapsed);
+    } else if (inputs.count > 1 || nfailed) {
+        fprintf(stderr, "\nConverted %zu of %zu files (%llu samples) in %.3f s using %u jobs.\n",
+                inputs.count - nfailed, inputs.count, nsamples, elapsed, njobs);
+        if (elapsed > 0.0) {
+            fprintf(stderr, "Throughput: %.1f files/s, %.1f samples/s\n",
+                    inputs.count / elapsed, nsamples / elapsed);
+        }
+    }
+
+    // --- Cleanup ---
+    for (size_t i = 0; i < inputs.count; ++i) {
+        free(jobs[i].output_filename);
+        free(jobs[i].output);
+        free(jobs[i].skipped);
+    }
+    free(jobs);
+    filename_list_free(&inputs);
+
+    return (nfailed || queue.stream_error) ? 1 : 0;
+}
+
+static void show_help(void)
+{
+    printf("dsf2csv - Divesoft Freedom .dsf to CSV Converter\n");
+    printf("Version: %s\n\n", DC_VERSION);
+    printf("Usage: ./dsf2csv [-j jobs] [-f format] [-o output] [-z] [-c] [-t] <input>...\n");
+    printf("       ./dsf2csv --help\n\n");
+    printf("Each input can be a .dsf/.dlf file, a directory containing such\n");
+    printf("files, a glob pattern, or '-' to read a list of files from stdin.\n");
+    printf("By default, every file is converted into a .csv file with the same\n");
+    printf("name (e.g., my_dive.dsf -> my_dive.csv). With -o, all dives are\n");
+    printf("written to a single output instead, in input order.\n\n");
+    printf("Options:\n");
+    printf("  -j, --jobs <n>       Number of worker threads (default: number of CPUs)\n");
+    printf("  -M, --no-mmap        Read the input files instead of memory mapping them\n");
+    printf("  -f, --format <fmt>   Output format: csv (default) or columnar (.dsfc)\n");
+    printf("  -o, --output <file>  Write all dives to <file>, or to stdout for '-'\n");
+    printf("  -z, --null           Terminate the CSV data of each dive with a NUL byte\n");
+    printf("  -c, --check          Only check the input files for errors, without\n");
+    printf("                       converting them\n");
+    printf("  -t, --tolerant       Skip damaged records and report them, instead of\n");
+    printf("                       rejecting the whole dive\n");
+    printf("  -h, --help           Show this help message\n\n");
+    printf("Status messages are written to stderr.\n");
+}
+
+static unsigned int default_job_count(void)
+{
+#if defined(HAVE_PTHREAD_H) && defined(HAVE_UNISTD_H) && defined(_SC_NPROCESSORS_ONLN)
+    long ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+    if (ncpus > MAX_JOBS) return MAX_JOBS;
+    if (ncpus > 0) return (unsigned int)ncpus;
+#endif
+    return 1;
+}
+
+static double monotonic_seconds(void)
+{
+#if defined(HAVE_CLOCK_GETTIME) && defined(CLOCK_MONOTONIC)
+    struct timespec ts;
+    if (clock_gettime(CLOCK_MONOTONIC, &ts) == 0) {
+        return ts.tv_sec + ts.tv_nsec / 1e9;
+    }
+#endif
+    return (double)time(NULL);
+}
+
+static int filename_list_add(filename_list_t *list, const char *filename)
+{
+    if (list->count == list->capacity) {
+        size_t capacity = list->capacity ? list->capacity * 2 : 64;
+        char **items = (char **)realloc(list->items, capacity * sizeof(char *));
+        if (!items) {
+            fprintf(stderr, "Error: Cannot allocate memory for the input list.\n");
+            return -1;
+        }
+        list->items = items;
+        list->capacity = capacity;
+    }
+
+    char *copy = strdup(filename);
+    if (!copy) {
+        fprintf(stderr, "Error: Cannot allocate memory for the input list.\n");
+        return -1;
+    }
+
+    list->items[list->count++] = copy;
+    return 0;
+}
+
+static void filename_list_free(filename_list_t *list)
+{
+    for (size_t i = 0; i < list->count; ++i) {
+        free(list->items[i]);
+    }
+    free(list->items);
+    list->items = NULL;
+    list->count = list->capacity = 0;
+}
+
+static int collect_inputs(filename_list_t *list, const char *argument)
+{
+    if (strcmp(argument, "-") == 0) {
+        return collect_stdin(list);
+    }
+
+    struct stat st;
+    if (stat(argument, &st) == 0) {
+        if (S_ISDIR(st.st_mode)) {
+            return collect_directory(list, argument);
+        }
+        return filename_list_add(list, argument);
+    }
+
+    // The shell did not expand the pattern (e.g. it was quoted to avoid
+    // the argument length limit), so expand it ourselves.
+    if (strpbrk(argument, "*?[") != NULL) {
+        return collect_glob(list, argument);
+    }
+
+    // Let the conversion report the error for this file.
+    return filename_list_add(list, argument);
+}
+
+static int collect_stdin(filename_list_t *list)
+{
+    char line[4096];
+    while (fgets(line, sizeof(line), stdin)) {
+        size_t len = strcspn(line, "\r\n");
+        line[len] = '\0';
+        if (len == 0) continue;
+        if (filename_list_add(list, line) != 0) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+static int collect_directory(filename_list_t *list, const char *dirname)
+{
+#ifdef HAVE_DIRENT_H
+    DIR *dir = opendir(dirname);
+    if (!dir) {
+        fprintf(stderr, "Error: Cannot open directory '%s'.\n", dirname);
+        return -1;
+    }
+
+    // Directory order is arbitrary, so sort the entries to keep the
+    // output deterministic.
+    filename_list_t entries = {NULL, 0, 0};
+    size_t dirlen = strlen(dirname);
+    struct dirent *entry = NULL;
+    while ((entry = readdir(dir)) != NULL) {
+        if (!has_log_extension(entry->d_name)) continue;
+
+        size_t len = dirlen + 1 + strlen(entry->d_name) + 1;
+        char *path = (char *)malloc(len);
+        if (!path) {
+            fprintf(stderr, "Error: Cannot allocate memory for the input list.\n");
+            filename_list_free(&entries);
+            closedir(dir);
+            return -1;
+        }
+        snprintf(path, len, "%s%s%s", dirname,
+                 (dirlen && dirname[dirlen - 1] == '/') ? "" : "/", entry->d_name);
+
+        int rc = filename_list_add(&entries, path);
+        free(path);
+        if (rc != 0) {
+            filename_list_free(&entries);
+            closedir(dir);
+            return -1;
+        }
+    }
+    closedir(dir);
+
+    if (entries.count) {
+        qsort(entries.items, entries.count, sizeof(char *), compare_filenames);
+    }
+
+    for (size_t i = 0; i < entries.count; ++i) {
+        if (filename_list_add(list, entries.items[i]) != 0) {
+            filename_list_free(&entries);
+            return -1;
+        }
+    }
+
+    filename_list_free(&entries);
+    return 0;
+#else
+    fprintf(stderr, "Error: Directory inputs are not supported on this platform ('%s').\n", dirname);
+    return -1;
+#endif
+}
+
+static int collect_glob(filename_list_t *list, const char *pattern)
+{
+#ifdef HAVE_GLOB_H
+    glob_t matches;
+    int rc = glob(pattern, 0, NULL, &matches);
+    if (rc == GLOB_NOMATCH) {
+        fprintf(stderr, "Error: No files match '%s'.\n", pattern);
+        return -1;
+    } else if (rc != 0) {
+        fprintf(stderr, "Error: Failed to expand '%s'.\n", pattern);
+        return -1;
+    }
+
+    // glob() returns the matches sorted.
+    for (size_t i = 0; i < matches.gl_pathc; ++i) {
+        if (filename_list_add(list, matches.gl_pathv[i]) != 0) {
+            globfree(&matches);
+            return -1;
+        }
+    }
+
+    globfree(&matches);
+    return 0;
+#else
+    return filename_list_add(list, pattern);
+#endif
+}
+
+static int has_log_extension(const char *filename)
+{
+    const char *dot = strrchr(filename, '.');
+    if (!dot) return 0;
+
+    return strcasecmp(dot, ".dsf") == 0 || strcasecmp(dot, ".dlf") == 0;
+}
+
+static int compare_filenames(const void *a, const void *b)
+{
+    return strcmp(*(char * const *)a, *(char * const *)b);
+}
+
+static char *derive_output_filename(const char *input_filename, const char *extension)
+{
+    size_t len = strlen(input_filename);
+    const char *dot = strrchr(input_filename, '.');
+    const char *slash = strrchr(input_filename, '/');
+    if (dot && (!slash || dot > slash)) {
+        len = dot - input_filename;
+    }
+
+    size_t extlen = strlen(extension);
+    char *output_filename = (char *)malloc(len + extlen + 1);
+    if (!output_filename) {
+        return NULL;
+    }
+
+    memcpy(output_filename, input_filename, len);
+    memcpy(output_filename + len, extension, extlen + 1);
+
+    return output_filename;
+}
+
+static void reject_duplicate_outputs(conversion_job_t *jobs, size_t njobs)
+{
+    // Two inputs that only differ in their extension (e.g. dive.dsf and
+    // dive.DLF) map onto the same CSV file. Workers would race on it, so
+    // only the first one in input order is converted.
+    for (size_t i = 1; i < njobs; ++i) {
+        for (size_t j = 0; j < i; ++j) {
+            if (jobs[j].status == DC_STATUS_SUCCESS &&
+                strcmp(jobs[i].output_filename, jobs[j].output_filename) == 0) {
+                fprintf(stderr, "Error: '%s' and '%s' both convert to '%s'; skipping the former.\n",
+                        jobs[i].input_filename, jobs[j].input_filename, jobs[i].output_filename);
+                jobs[i].status = DC_STATUS_INVALIDARGS;
+                break;
+            }
+        }
+    }
+}
+
+static conversion_job_t *job_queue_next(job_queue_t *queue)
+{
+    conversion_job_t *job = NULL;
+
+#ifdef HAVE_PTHREAD_H
+    pthread_mutex_lock(&queue->lock);
+#endif
+    while (queue->next < queue->njobs) {
+        conversion_job_t *candidate = &queue->jobs[queue->next++];
+        if (candidate->status == DC_STATUS_SUCCESS) {
+            job = candidate;
+            break;
+        }
+        candidate->done = 1;
+    }
+#ifdef HAVE_PTHREAD_H
+    pthread_mutex_unlock(&queue->lock);
+#endif
+
+    return job;
+}
+
+static void job_queue_complete(job_queue_t *queue, conversion_job_t *job)
+{
+#ifdef HAVE_PTHREAD_H
+    pthread_mutex_lock(&queue->lock);
+#endif
+    job->done = 1;
+#ifdef HAVE_PTHREAD_H
+    pthread_mutex_unlock(&queue->lock);
+#endif
+
+    job_queue_write_ready(queue);
+}
+
+static void job_queue_write_ready(job_queue_t *queue)
+{
+    if (!queue->capture) return;
+
+#ifdef HAVE_PTHREAD_H
+    pthread_mutex_lock(&queue->lock);
+#endif
+    // Rejected dives are written as empty records, so the records in the
+    // stream still line up with the inputs.
+    while (queue->next_output < queue->njobs && queue->jobs[queue->next_output].done) {
+        conversion_job_t *job = &queue->jobs[queue->next_output++];
+        if (job->output_size && fwrite(job->output, 1, job->output_size, queue->stream) != job->output_size) {
+            queue->stream_error = 1;
+        }
+        if (queue->separator && fputc('\0', queue->stream) == EOF) {
+            queue->stream_error = 1;
+        }
+        free(job->output);
+        job->output = NULL;
     }
+#ifdef HAVE_PTHREAD_H
+    pthread_mutex_unlock(&queue->lock);
+#endif
+}
 
-    const char *input_filename = argv[1];
+static void *worker_main(void *arg)
+{
+    job_queue_t *queue = (job_queue_t *)arg;
+    conversion_job_t *job = NULL;
 
-    // --- libdivecomputer setup ---
+    // Every worker has its own context and descriptor, so nothing from
+    // libdivecomputer is shared between threads.
     dc_context_t *context = NULL;
     dc_status_t status = dc_context_new(&context);
     if (status != DC_STATUS_SUCCESS) {
         fprintf(stderr, "Error: Failed to create libdivecomputer context (code: %d)\n", status);
-        return 1;
+        return NULL;
     }
 
     dc_context_set_loglevel(context, DC_LOGLEVEL_WARNING);
 
-    // --- Read input file ---
-    unsigned char *file_buffer = NULL;
-    size_t file_size = 0;
-    status = read_file_into_buffer(input_filename, &file_buffer, &file_size);
-    if (status != DC_STATUS_SUCCESS) {
+    dc_descriptor_t *descriptor = find_descriptor(context);
+    if (descriptor == NULL) {
+        fprintf(stderr, "Error: Divesoft Freedom descriptor not found in library.\n");
+        while ((job = job_queue_next(queue)) != NULL) {
+            job->status = DC_STATUS_UNSUPPORTED;
+            job_queue_complete(queue, job);
+        }
         dc_context_free(context);
-        return 1;
+        return NULL;
     }
 
-    // --- Find Divesoft Freedom descriptor ---
+    // One parser is reused for all the files of this worker.
+    dc_parser_t *parser = NULL;
+    while ((job = job_queue_next(queue)) != NULL) {
+        job->status = convert_file(job, &parser, context, descriptor, queue);
+        if (queue->stream && !queue->capture && queue->separator) {
+            if (fputc('\0', queue->stream) == EOF) {
+                queue->stream_error = 1;
+            }
+        }
+        job_queue_complete(queue, job);
+    }
+
+    dc_parser_destroy(parser);
+    dc_descriptor_free(descriptor);
+    dc_context_free(context);
+
+    return NULL;
+}
+
+static dc_descriptor_t *find_descriptor(dc_context_t *context)
+{
     dc_iterator_t *iter = NULL;
     dc_descriptor_t *descriptor = NULL;
     dc_descriptor_iterator_new(&iter, context);
@@ -94,180 +787,531 @@ int main(int argc, char *argv[])
     }
     dc_iterator_free(iter);
 
-    if (descriptor == NULL) {
-        fprintf(stderr, "Error: Divesoft Freedom descriptor not found in library.\n");
-        free(file_buffer);
-        dc_context_free(context);
-        return 1;
-    }
+    return descriptor;
+}
 
-    // --- Create Parser ---
-    dc_parser_t *parser = NULL;
-    status = dc_parser_new2(&parser, context, descriptor, file_buffer, file_size);
-    dc_descriptor_free(descriptor); // Free the descriptor when done
+// Keep a copy of the skipped parts of the dive, for the report.
+static dc_status_t collect_skipped(conversion_job_t *job, dc_parser_t *parser)
+{
+    divesoft_freedom_diagnostics_t diagnostics;
+    dc_status_t status = divesoft_freedom_parser_get_diagnostics(parser, &diagnostics);
+    if (status != DC_STATUS_SUCCESS || diagnostics.nranges == 0) {
+        return status;
+    }
 
-    if (status != DC_STATUS_SUCCESS) {
-        fprintf(stderr, "Error: Failed to create parser (code: %d). Is this a valid .dsf file?\n", status);
-        free(file_buffer);
-        dc_context_free(context);
-        return 1;
+    job->skipped = (divesoft_freedom_range_t *)malloc(diagnostics.nranges * sizeof(divesoft_freedom_range_t));
+    if (!job->skipped) {
+        return DC_STATUS_NOMEMORY;
     }
+    memcpy(job->skipped, diagnostics.ranges, diagnostics.nranges * sizeof(divesoft_freedom_range_t));
+    job->nskipped = diagnostics.nranges;
 
-    printf("Successfully created parser for %s.\n\n", input_filename);
+    return DC_STATUS_SUCCESS;
+}
 
-    // --- Extract Metadata and Write CSV Header ---
-    dc_datetime_t datetime;
-    if (dc_parser_get_datetime(parser, &datetime) == DC_STATUS_SUCCESS) {
-        printf("Dive Date/Time: %04d-%02d-%02d %02d:%02d:%02d\n",
-               datetime.year, datetime.month, datetime.day,
-               datetime.hour, datetime.minute, datetime.second);
+static dc_status_t convert_file(conversion_job_t *job, dc_parser_t **parser, dc_context_t *context, dc_descriptor_t *descriptor, job_queue_t *queue)
+{
+    // --- Read input file ---
+    input_file_t input;
+    dc_status_t status = open_input_file(job->input_filename, &input, queue->use_mmap);
+    if (status != DC_STATUS_SUCCESS) {
+        return status;
     }
 
-    double max_depth;
-    if (dc_parser_get_field(parser, DC_FIELD_MAXDEPTH, 0, &max_depth) == DC_STATUS_SUCCESS) {
-        printf("Max Depth: %.2f m\n", max_depth);
+    // --- Bind the parser ---
+    // The parser borrows the input data instead of copying it. It is
+    // created for the first file of the worker, and rebound to the data
+    // of every next file, so its memory is reused.
+    if (*parser == NULL) {
+        status = dc_parser_new2_borrowed(parser, context, descriptor, input.data, input.size);
+        if (status == DC_STATUS_SUCCESS && queue->tolerant) {
+            divesoft_freedom_parser_set_tolerant(*parser, 1);
+        }
+    } else {
+        status = dc_parser_reset(*parser, input.data, input.size);
+    }
+    if (status != DC_STATUS_SUCCESS) {
+        fprintf(stderr, "Error: Failed to create parser for '%s' (code: %d). Is this a valid .dsf file?\n",
+                job->input_filename, status);
+        close_input_file(&input);
+        return status;
     }
 
-    unsigned int divetime;
-    if (dc_parser_get_field(parser, DC_FIELD_DIVETIME, 0, &divetime) == DC_STATUS_SUCCESS) {
-        printf("Dive Time: %u min\n", divetime / 60);
+    // --- Validate ---
+    // Corrupt files are rejected cheaply, before decoding the samples and
+    // creating any output. In tolerant mode, the damaged parts of the
+    // profile are skipped, and they are collected for the report instead.
+    status = divesoft_freedom_parser_validate(*parser);
+    if (status == DC_STATUS_SUCCESS && queue->tolerant) {
+        status = collect_skipped(job, *parser);
     }
+    if (status != DC_STATUS_SUCCESS || queue->check) {
+        close_input_file(&input);
+        return status;
+    }
+
+    // --- Extract Metadata ---
+    // All the fields are read in one call. A field that fails is only
+    // left out, so the status is not checked.
+    dc_summary_t summary;
+    dc_parser_get_summary(*parser, &summary);
+    job->have_datetime = dc_parser_get_datetime(*parser, &job->datetime) == DC_STATUS_SUCCESS;
+    job->have_maxdepth = (summary.fields & DC_FIELD_MASK(DC_FIELD_MAXDEPTH)) != 0;
+    job->max_depth = summary.maxdepth;
+    job->have_divetime = (summary.fields & DC_FIELD_MASK(DC_FIELD_DIVETIME)) != 0;
+    job->divetime = summary.divetime;
 
-    char output_filename[256];
-    strncpy(output_filename, input_filename, sizeof(output_filename) - 5);
-    output_filename[sizeof(output_filename) - 5] = '\0';
-    char *dot = strrchr(output_filename, '.');
-    if (dot) {
-        strcpy(dot, ".csv");
+    // --- Write the output ---
+    if (queue->format == OUTPUT_COLUMNAR) {
+        status = write_columnar(job, *parser, &summary, queue);
     } else {
-        strcat(output_filename, ".csv");
+        status = write_csv(job, *parser, queue);
     }
 
-    FILE *output_file = fopen(output_filename, "w");
-    if (!output_file) {
-        fprintf(stderr, "Error: Could not open output file %s\n", output_filename);
-        dc_parser_destroy(parser);
-        free(file_buffer);
-        dc_context_free(context);
-        return 1;
+    close_input_file(&input);
+
+    return status;
+}
+
+static dc_status_t write_csv(conversion_job_t *job, dc_parser_t *parser, job_queue_t *queue)
+{
+    dc_status_t status = DC_STATUS_SUCCESS;
+
+    // --- Write CSV Header ---
+    // The dive goes to its own file, directly to the shared output stream,
+    // or into memory until it is its turn to be written to the stream.
+    FILE *output_file = NULL;
+    if (queue->stream == NULL) {
+        output_file = fopen(job->output_filename, "w");
+        if (!output_file) {
+            fprintf(stderr, "Error: Could not open output file %s\n", job->output_filename);
+            return DC_STATUS_IO;
+        }
+    } else if (!queue->capture) {
+        output_file = queue->stream;
+    }
+
+    csv_writer_t writer;
+    if (csv_writer_init(&writer, output_file, 0) != 0) {
+        fprintf(stderr, "Error: Cannot allocate memory for the output buffer.\n");
+        if (queue->stream == NULL) fclose(output_file);
+        return DC_STATUS_NOMEMORY;
     }
 
-    fprintf(output_file, "Time,Depth,Temperature,PPO2,CNS,Setpoint,DecoType,DecoTime,DecoDepth\n");
-    printf("\nCSV file created: %s\n", output_filename);
-    printf("Writing sample data...\n");
+    csv_writer_write_header(&writer);
 
     // --- Process Samples ---
     sample_data_t current_sample;
-    reset_sample_data(&current_sample);
+    sample_data_reset(&current_sample);
 
     callback_userdata_t userdata = {
-        .outfile = output_file,
-        .current_sample = &current_sample
+        .writer = &writer,
+        .current_sample = &current_sample,
+        .nsamples = 0
     };
 
-    status = dc_parser_samples_foreach(parser, sample_callback, &userdata);
-    if (status != DC_STATUS_SUCCESS) {
-        fprintf(stderr, "Error during sample processing (code: %d)\n", status);
+    // On a sample error, the rows decoded so far are still written, in
+    // the same way with any number of jobs, but the dive counts as failed.
+    dc_status_t rc = dc_parser_samples_foreach_filtered(parser, SAMPLE_DATA_TYPES, 0, DC_SAMPLE_TIME_END, sample_callback, &userdata);
+    if (rc != DC_STATUS_SUCCESS) {
+        fprintf(stderr, "Error during sample processing of '%s' (code: %d)\n", job->input_filename, rc);
     }
 
-    write_sample_to_csv(output_file, &current_sample);
+    write_sample(&userdata, &current_sample);
+    job->nsamples = userdata.nsamples;
 
-    printf("Sample data written successfully.\n");
+    // --- Finish ---
+    if (queue->capture) {
+        if (writer.error) {
+            fprintf(stderr, "Error: Cannot allocate memory for the CSV data of '%s'.\n", job->input_filename);
+            status = DC_STATUS_NOMEMORY;
+        } else {
+            job->output = csv_writer_release(&writer, &job->output_size);
+        }
+        csv_writer_finish(&writer);
+    } else if (queue->stream) {
+        if (csv_writer_finish(&writer) != 0) {
+            fprintf(stderr, "Error: Failed to write to %s\n", queue->stream_name);
+            status = DC_STATUS_IO;
+        }
+    } else {
+        int write_error = csv_writer_finish(&writer) != 0;
+        if (fclose(output_file) != 0 || write_error) {
+            fprintf(stderr, "Error: Failed to write output file %s\n", job->output_filename);
+            status = DC_STATUS_IO;
+        }
+    }
 
-    // --- Cleanup ---
-    fclose(output_file);
-    dc_parser_destroy(parser);
-    free(file_buffer);
-    dc_context_free(context);
+    if (status == DC_STATUS_SUCCESS) {
+        status = rc;
+    }
 
-    return 0;
+    return status;
 }
 
-static void show_help(void)
+static dc_status_t write_columnar(conversion_job_t *job, dc_parser_t *parser, const dc_summary_t *summary, job_queue_t *queue)
 {
-    printf("dsf2csv - Divesoft Freedom .dsf to CSV Converter\n");
-    printf("Version: %s\n\n", DC_VERSION);
-    printf("Usage: ./dsf2csv <input.dsf>\n");
-    printf("       ./dsf2csv --help\n\n");
-    printf("This tool reads a single .dsf file and outputs a .csv file\n");
-    printf("with the same name (e.g., my_dive.dsf -> my_dive.csv).\n");
+    column_writer_t columns;
+    column_writer_init(&columns);
+    add_dive_metadata(&columns, job, summary);
+
+    // --- Process Samples ---
+    sample_data_t current_sample;
+    sample_data_reset(&current_sample);
+
+    callback_userdata_t userdata = {
+        .columns = &columns,
+        .current_sample = &current_sample,
+        .nsamples = 0
+    };
+
+    // On a sample error, the rows decoded so far are still written, in
+    // the same way with any number of jobs, but the dive counts as failed.
+    dc_status_t rc = dc_parser_samples_foreach_filtered(parser, SAMPLE_DATA_TYPES, 0, DC_SAMPLE_TIME_END, sample_callback, &userdata);
+    if (rc != DC_STATUS_SUCCESS) {
+        fprintf(stderr, "Error during sample processing of '%s' (code: %d)\n", job->input_filename, rc);
+    }
+
+    write_sample(&userdata, &current_sample);
+    job->nsamples = userdata.nsamples;
+
+    // --- Finish ---
+    char *data = NULL;
+    size_t size = 0;
+    int error = column_writer_serialize(&columns, &data, &size) != 0;
+    column_writer_free(&columns);
+    if (error) {
+        fprintf(stderr, "Error: Cannot allocate memory for the columns of '%s'.\n", job->input_filename);
+        return DC_STATUS_NOMEMORY;
+    }
+
+    if (queue->capture) {
+        job->output = data;
+        job->output_size = size;
+        return rc;
+    }
+
+    dc_status_t status = write_output(job, queue, data, size);
+    free(data);
+
+    if (status == DC_STATUS_SUCCESS) {
+        status = rc;
+    }
+
+    return status;
 }
 
-static dc_status_t read_file_into_buffer(const char *filename, unsigned char **buffer, size_t *size)
+// Store the dive summary as key/value metadata, next to the columns.
+static void add_dive_metadata(column_writer_t *columns, const conversion_job_t *job, const dc_summary_t *summary)
 {
-    FILE *file = fopen(filename, "rb");
-    if (!file) {
-        fprintf(stderr, "Error: Cannot open file '%s'.\n", filename);
-        return DC_STATUS_INVALIDARGS;
+    char value[COLUMN_MAX_VALUE];
+
+    column_writer_add_metadata(columns, "source", job->input_filename);
+
+    if (job->have_datetime) {
+        snprintf(value, sizeof(value), "%04d-%02d-%02dT%02d:%02d:%02d",
+                 job->datetime.year, job->datetime.month, job->datetime.day,
+                 job->datetime.hour, job->datetime.minute, job->datetime.second);
+        column_writer_add_metadata(columns, "datetime", value);
     }
 
-    fseek(file, 0, SEEK_END);
-    *size = ftell(file);
-    fseek(file, 0, SEEK_SET);
+    if (job->have_divetime) {
+        snprintf(value, sizeof(value), "%u", job->divetime);
+        column_writer_add_metadata(columns, "divetime_s", value);
+    }
 
-    if (*size == 0) {
-        fprintf(stderr, "Error: File '%s' is empty.\n", filename);
-        fclose(file);
-        return DC_STATUS_INVALIDARGS;
+    if (job->have_maxdepth) {
+        snprintf(value, sizeof(value), "%.2f", job->max_depth);
+        column_writer_add_metadata(columns, "maxdepth_m", value);
     }
 
-    *buffer = (unsigned char *)malloc(*size);
-    if (!*buffer) {
-        fprintf(stderr, "Error: Cannot allocate memory to read file.\n");
-        fclose(file);
-        return DC_STATUS_NOMEMORY;
+    const struct {
+        dc_field_type_t type;
+        const char *key;
+        double number;
+    } doubles[] = {
+        {DC_FIELD_AVGDEPTH,            "avgdepth_m",            summary->avgdepth},
+        {DC_FIELD_ATMOSPHERIC,         "atmospheric_bar",       summary->atmospheric},
+        {DC_FIELD_TEMPERATURE_SURFACE, "temperature_surface_c", summary->temperature_surface},
+        {DC_FIELD_TEMPERATURE_MINIMUM, "temperature_minimum_c", summary->temperature_minimum},
+        {DC_FIELD_TEMPERATURE_MAXIMUM, "temperature_maximum_c", summary->temperature_maximum},
+    };
+    for (size_t i = 0; i < sizeof(doubles) / sizeof(doubles[0]); ++i) {
+        if (summary->fields & DC_FIELD_MASK(doubles[i].type)) {
+            snprintf(value, sizeof(value), "%.2f", doubles[i].number);
+            column_writer_add_metadata(columns, doubles[i].key, value);
+        }
+    }
+
+    const struct {
+        dc_field_type_t type;
+        const char *key;
+        unsigned int number;
+    } counts[] = {
+        {DC_FIELD_GASMIX_COUNT, "gasmix_count", summary->ngasmixes},
+        {DC_FIELD_TANK_COUNT,   "tank_count",   summary->ntanks},
+    };
+    for (size_t i = 0; i < sizeof(counts) / sizeof(counts[0]); ++i) {
+        if (summary->fields & DC_FIELD_MASK(counts[i].type)) {
+            snprintf(value, sizeof(value), "%u", counts[i].number);
+            column_writer_add_metadata(columns, counts[i].key, value);
+        }
+    }
+
+    if (summary->fields & DC_FIELD_MASK(DC_FIELD_SALINITY)) {
+        snprintf(value, sizeof(value), "%s/%.1f",
+                 summary->salinity.type == DC_WATER_SALT ? "salt" : "fresh", summary->salinity.density);
+        column_writer_add_metadata(columns, "salinity", value);
+    }
+
+    if (summary->fields & DC_FIELD_MASK(DC_FIELD_DIVEMODE)) {
+        static const char *names[] = {"freedive", "gauge", "oc", "ccr", "scr"};
+        if ((unsigned int)summary->divemode < sizeof(names) / sizeof(names[0])) {
+            column_writer_add_metadata(columns, "divemode", names[summary->divemode]);
+        }
+    }
+}
+
+// Write a complete, serialized dive to its own file or the shared stream.
+static dc_status_t write_output(const conversion_job_t *job, job_queue_t *queue, const char *data, size_t size)
+{
+    if (queue->stream) {
+        if (fwrite(data, 1, size, queue->stream) != size) {
+            fprintf(stderr, "Error: Failed to write to %s\n", queue->stream_name);
+            return DC_STATUS_IO;
+        }
+        return DC_STATUS_SUCCESS;
     }
 
-    if (fread(*buffer, 1, *size, file) != *size) {
-        fprintf(stderr, "Error: Failed to read the entire file '%s'.\n", filename);
-        fclose(file);
-        free(*buffer);
+    FILE *fp = fopen(job->output_filename, "wb");
+    if (!fp) {
+        fprintf(stderr, "Error: Could not open output file %s\n", job->output_filename);
+        return DC_STATUS_IO;
+    }
+
+    int write_error = fwrite(data, 1, size, fp) != size;
+    if (fclose(fp) != 0 || write_error) {
+        fprintf(stderr, "Error: Failed to write output file %s\n", job->output_filename);
         return DC_STATUS_IO;
     }
 
-    fclose(file);
     return DC_STATUS_SUCCESS;
 }
 
-static void reset_sample_data(sample_data_t *sample)
+static const char *skip_reason(unsigned int reason)
 {
-    sample->time = 0;
-    sample->depth = -1.0;
-    sample->temperature = -999.0;
-    sample->ppo2 = -1.0;
-    sample->cns = -1.0;
-    sample->setpoint = -1.0;
-    sample->deco_type = DC_DECO_NDL;
-    sample->deco_time = 0;
-    sample->deco_depth = 0.0;
-    sample->dirty = 0;
+    switch (reason) {
+    case DIVESOFT_FREEDOM_SKIP_TIMESTAMP: return "timestamp out of sequence";
+    case DIVESOFT_FREEDOM_SKIP_TYPE:      return "unknown record type";
+    case DIVESOFT_FREEDOM_SKIP_GASMIX:    return "too many gas mixes";
+    case DIVESOFT_FREEDOM_SKIP_TANK:      return "unknown tank";
+    case DIVESOFT_FREEDOM_SKIP_TRUNCATED: return "truncated record";
+    default:                              return "unknown";
+    }
 }
 
-static void write_sample_to_csv(FILE *outfile, sample_data_t *sample)
+static void report_skipped(const conversion_job_t *job)
 {
-    if (!sample->dirty) return;
+    for (unsigned int i = 0; i < job->nskipped; ++i) {
+        fprintf(stderr, "Skipped %u bytes at offset %u: %s\n",
+                job->skipped[i].size, job->skipped[i].offset, skip_reason(job->skipped[i].reason));
+    }
+}
 
-    fprintf(outfile, "%u,", sample->time / 1000);
+static void report_job(const conversion_job_t *job, const job_queue_t *queue)
+{
+    if (queue->check) {
+        if (job->status == DC_STATUS_SUCCESS) {
+            fprintf(stderr, "Valid: %s\n", job->input_filename);
+            report_skipped(job);
+        } else {
+            fprintf(stderr, "Invalid: %s (code: %d)\n", job->input_filename, job->status);
+        }
+        return;
+    }
 
-    if (sample->depth >= 0.0) fprintf(outfile, "%.2f", sample->depth);
-    fprintf(outfile, ",");
+    if (job->status != DC_STATUS_SUCCESS) {
+        fprintf(stderr, "Failed to convert %s (code: %d).\n", job->input_filename, job->status);
+        return;
+    }
 
-    if (sample->temperature > -999.0) fprintf(outfile, "%.1f", sample->temperature);
-    fprintf(outfile, ",");
+    fprintf(stderr, "Successfully created parser for %s.\n\n", job->input_filename);
 
-    if (sample->ppo2 >= 0.0) fprintf(outfile, "%.2f", sample->ppo2);
-    fprintf(outfile, ",");
+    if (job->have_datetime) {
+        fprintf(stderr, "Dive Date/Time: %04d-%02d-%02d %02d:%02d:%02d\n",
+                job->datetime.year, job->datetime.month, job->datetime.day,
+                job->datetime.hour, job->datetime.minute, job->datetime.second);
+    }
 
-    if (sample->cns >= 0.0) fprintf(outfile, "%.2f", sample->cns);
-    fprintf(outfile, ",");
+    if (job->have_maxdepth) {
+        fprintf(stderr, "Max Depth: %.2f m\n", job->max_depth);
+    }
+
+    if (job->have_divetime) {
+        fprintf(stderr, "Dive Time: %u min\n", job->divetime / 60);
+    }
 
-    if (sample->setpoint >= 0.0) fprintf(outfile, "%.2f", sample->setpoint);
-    fprintf(outfile, ",");
+    if (queue->stream) {
+        fprintf(stderr, "\n%s data written to %s\n",
+                queue->format == OUTPUT_COLUMNAR ? "Columnar" : "CSV", queue->stream_name);
+    } else {
+        fprintf(stderr, "\n%s file created: %s\n",
+                queue->format == OUTPUT_COLUMNAR ? "Columnar" : "CSV", job->output_filename);
+    }
+    fprintf(stderr, "Sample data written successfully (%u samples).\n", job->nsamples);
 
-    const char *deco_type_str = "NDL";
-    if (sample->deco_type == DC_DECO_DECOSTOP) deco_type_str = "DECOSTOP";
-    else if (sample->deco_type == DC_DECO_SAFETYSTOP) deco_type_str = "SAFETYSTOP";
-    fprintf(outfile, "%s,%u,%.2f\n", deco_type_str, sample->deco_time, sample->deco_depth);
+    if (job->nskipped) {
+        fprintf(stderr, "\n");
+        report_skipped(job);
+    }
+}
+
+static dc_status_t open_input_file(const char *filename, input_file_t *input, int use_mmap)
+{
+    input->data = NULL;
+    input->size = 0;
+    input->mapping = NULL;
+    input->buffer = NULL;
+
+    FILE *file = NULL;
+
+#ifdef USE_MMAP
+    if (use_mmap) {
+        int fd = open(filename, O_RDONLY);
+        if (fd < 0) {
+            fprintf(stderr, "Error: Cannot open file '%s'.\n", filename);
+            return DC_STATUS_INVALIDARGS;
+        }
+
+        struct stat st;
+        if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode)) {
+            if (st.st_size == 0) {
+                fprintf(stderr, "Error: File '%s' is empty.\n", filename);
+                close(fd);
+                return DC_STATUS_INVALIDARGS;
+            }
+
+            void *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (data != MAP_FAILED) {
+#ifdef MADV_SEQUENTIAL
+                madvise(data, st.st_size, MADV_SEQUENTIAL);
+#endif
+                close(fd);
+                input->data = (const unsigned char *)data;
+                input->size = st.st_size;
+                input->mapping = data;
+                return DC_STATUS_SUCCESS;
+            }
+        }
+
+        // Not a regular file (e.g. a pipe), or the mapping failed. Fall
+        // back to reading the file, until the end of the data. The file
+        // is not opened again, since a pipe can only be read once.
+        file = fdopen(fd, "rb");
+        if (!file) {
+            fprintf(stderr, "Error: Cannot open file '%s'.\n", filename);
+            close(fd);
+            return DC_STATUS_INVALIDARGS;
+        }
+    }
+#endif
+
+    if (!file) {
+        file = fopen(filename, "rb");
+        if (!file) {
+            fprintf(stderr, "Error: Cannot open file '%s'.\n", filename);
+            return DC_STATUS_INVALIDARGS;
+        }
+    }
+
+    dc_status_t status = read_file_into_buffer(file, filename, &input->buffer, &input->size);
+    if (status != DC_STATUS_SUCCESS) {
+        return status;
+    }
+
+    input->data = input->buffer;
+    return DC_STATUS_SUCCESS;
+}
+
+static void close_input_file(input_file_t *input)
+{
+#ifdef USE_MMAP
+    if (input->mapping) {
+        munmap(input->mapping, input->size);
+    }
+#endif
+    free(input->buffer);
+    input->data = NULL;
+    input->mapping = NULL;
+    input->buffer = NULL;
+}
+
+// Read an open file into a newly allocated buffer, and close it.
+static dc_status_t read_file_into_buffer(FILE *file, const char *filename, unsigned char **buffer, size_t *size)
+{
+    // The size of a regular file is only used as the initial capacity.
+    // Input that can't be seeked (e.g. a pipe) is read until the end,
+    // and the buffer grows as needed.
+    size_t capacity = READ_CHUNK;
+    if (fseek(file, 0, SEEK_END) == 0) {
+        long end = ftell(file);
+        if (end > 0) {
+            capacity = (size_t)end + 1;
+        }
+        if (fseek(file, 0, SEEK_SET) != 0) {
+            capacity = READ_CHUNK;
+        }
+    }
+
+    unsigned char *data = NULL;
+    size_t length = 0;
+    for (;;) {
+        if (length == capacity || data == NULL) {
+            size_t newcapacity = data ? capacity * 2 : capacity;
+            unsigned char *newdata = (unsigned char *)realloc(data, newcapacity);
+            if (!newdata) {
+                fprintf(stderr, "Error: Cannot allocate memory to read file.\n");
+                fclose(file);
+                free(data);
+                return DC_STATUS_NOMEMORY;
+            }
+            data = newdata;
+            capacity = newcapacity;
+        }
+
+        size_t n = fread(data + length, 1, capacity - length, file);
+        length += n;
+        if (length < capacity) {
+            if (ferror(file)) {
+                fprintf(stderr, "Error: Failed to read the entire file '%s'.\n", filename);
+                fclose(file);
+                free(data);
+                return DC_STATUS_IO;
+            }
+            break;
+        }
+    }
+
+    fclose(file);
+
+    if (length == 0) {
+        fprintf(stderr, "Error: File '%s' is empty.\n", filename);
+        free(data);
+        return DC_STATUS_INVALIDARGS;
+    }
+
+    *buffer = data;
+    *size = length;
+    return DC_STATUS_SUCCESS;
+}
+
+static void write_sample(callback_userdata_t *data, const sample_data_t *sample)
+{
+    if (data->columns) {
+        column_writer_write_sample(data->columns, sample);
+    } else {
+        csv_writer_write_sample(data->writer, sample);
+    }
 }
 
 static void sample_callback(dc_sample_type_t type, const dc_sample_value_t *value, void *userdata)
@@ -275,24 +1319,12 @@ static void sample_callback(dc_sample_type_t type, const dc_sample_value_t *valu
     callback_userdata_t *data = (callback_userdata_t *)userdata;
     sample_data_t *sample = data->current_sample;
 
+    // A new timestamp starts a new row.
     if (type == DC_SAMPLE_TIME) {
-        write_sample_to_csv(data->outfile, sample);
-        reset_sample_data(sample);
-        sample->time = value->time;
-        sample->dirty = 1;
-    } else if (type == DC_SAMPLE_DEPTH) {
-        sample->depth = value->depth;
-    } else if (type == DC_SAMPLE_TEMPERATURE) {
-        sample->temperature = value->temperature;
-    } else if (type == DC_SAMPLE_PPO2) {
-        sample->ppo2 = value->ppo2.value;
-    } else if (type == DC_SAMPLE_CNS) {
-        sample->cns = value->cns;
-    } else if (type == DC_SAMPLE_SETPOINT) {
-        sample->setpoint = value->setpoint;
-    } else if (type == DC_SAMPLE_DECO) {
-        sample->deco_type = value->deco.type;
-        sample->deco_time = value->deco.time;
-        sample->deco_depth = value->deco.depth;
+        write_sample(data, sample);
+        sample_data_reset(sample);
+        data->nsamples++;
     }
+
+    sample_data_update(sample, type, value);
 }
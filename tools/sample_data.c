@@ -0,0 +1,128 @@
+/*
+ * dsf2csv - A simple tool to convert Divesoft Freedom .dsf files to CSV.
+ *
+ * The row model.
+ *
+ * Copyright (C) 2023 Jules
+ */
+
+#include <string.h>
+
+#include "sample_data.h"
+
+#define NTYPES (DC_SAMPLE_GASMIX + 1)
+
+typedef void (*sample_handler_t)(sample_data_t *sample, const dc_sample_value_t *value);
+
+// An empty row. Resetting a row is a single copy of this template.
+static const sample_data_t empty_sample = {
+    .time = 0,
+    .depth = -1.0,
+    .temperature = -999.0,
+    .ppo2 = -1.0,
+    .ppo2_sensor = {-1.0, -1.0, -1.0, -1.0},
+    .pressure = {-1.0, -1.0, -1.0, -1.0, -1.0, -1.0, -1.0, -1.0, -1.0, -1.0, -1.0, -1.0},
+    .cns = -1.0,
+    .setpoint = -1.0,
+    .deco_type = DC_DECO_NDL,
+    .deco_time = 0,
+    .deco_depth = 0.0,
+    .tts = 0,
+    .gasmix = SAMPLE_UNDEFINED,
+    .bearing = SAMPLE_UNDEFINED,
+    .dirty = 0
+};
+
+static void update_none(sample_data_t *sample, const dc_sample_value_t *value)
+{
+    (void)sample;
+    (void)value;
+}
+
+static void update_time(sample_data_t *sample, const dc_sample_value_t *value)
+{
+    sample->time = value->time;
+    sample->dirty = 1;
+}
+
+static void update_depth(sample_data_t *sample, const dc_sample_value_t *value)
+{
+    sample->depth = value->depth;
+}
+
+static void update_pressure(sample_data_t *sample, const dc_sample_value_t *value)
+{
+    // Tanks beyond the last column are dropped.
+    double discard;
+    double *slot = value->pressure.tank < SAMPLE_NTANKS ? &sample->pressure[value->pressure.tank] : &discard;
+    *slot = value->pressure.value;
+}
+
+static void update_temperature(sample_data_t *sample, const dc_sample_value_t *value)
+{
+    sample->temperature = value->temperature;
+}
+
+static void update_bearing(sample_data_t *sample, const dc_sample_value_t *value)
+{
+    sample->bearing = value->bearing;
+}
+
+static void update_setpoint(sample_data_t *sample, const dc_sample_value_t *value)
+{
+    sample->setpoint = value->setpoint;
+}
+
+static void update_ppo2(sample_data_t *sample, const dc_sample_value_t *value)
+{
+    // DC_SENSOR_NONE (and any unknown sensor) goes into the main column.
+    double *slot = value->ppo2.sensor < SAMPLE_NSENSORS ? &sample->ppo2_sensor[value->ppo2.sensor] : &sample->ppo2;
+    *slot = value->ppo2.value;
+}
+
+static void update_cns(sample_data_t *sample, const dc_sample_value_t *value)
+{
+    sample->cns = value->cns;
+}
+
+static void update_deco(sample_data_t *sample, const dc_sample_value_t *value)
+{
+    sample->deco_type = value->deco.type;
+    sample->deco_time = value->deco.time;
+    sample->deco_depth = value->deco.depth;
+    sample->tts = value->deco.tts;
+}
+
+static void update_gasmix(sample_data_t *sample, const dc_sample_value_t *value)
+{
+    sample->gasmix = value->gasmix;
+}
+
+static const sample_handler_t handlers[NTYPES] = {
+    [DC_SAMPLE_TIME]        = update_time,
+    [DC_SAMPLE_DEPTH]       = update_depth,
+    [DC_SAMPLE_PRESSURE]    = update_pressure,
+    [DC_SAMPLE_TEMPERATURE] = update_temperature,
+    [DC_SAMPLE_EVENT]       = update_none,
+    [DC_SAMPLE_RBT]         = update_none,
+    [DC_SAMPLE_HEARTBEAT]   = update_none,
+    [DC_SAMPLE_BEARING]     = update_bearing,
+    [DC_SAMPLE_VENDOR]      = update_none,
+    [DC_SAMPLE_SETPOINT]    = update_setpoint,
+    [DC_SAMPLE_PPO2]        = update_ppo2,
+    [DC_SAMPLE_CNS]         = update_cns,
+    [DC_SAMPLE_DECO]        = update_deco,
+    [DC_SAMPLE_GASMIX]      = update_gasmix,
+};
+
+void sample_data_reset(sample_data_t *sample)
+{
+    memcpy(sample, &empty_sample, sizeof(*sample));
+}
+
+void sample_data_update(sample_data_t *sample, dc_sample_type_t type, const dc_sample_value_t *value)
+{
+    if ((unsigned int)type >= NTYPES) return;
+
+    handlers[type](sample, value);
+}
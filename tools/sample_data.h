@@ -0,0 +1,64 @@
+/*
+ * dsf2csv - A simple tool to convert Divesoft Freedom .dsf files to CSV.
+ *
+ * The row model. All the samples the parser reports for one timestamp
+ * are collected into a single fixed-width row, with a separate slot for
+ * every ppO2 sensor and every tank.
+ *
+ * Copyright (C) 2023 Jules
+ */
+
+#ifndef SAMPLE_DATA_H
+#define SAMPLE_DATA_H
+
+#include "libdivecomputer/parser.h"
+
+// The number of oxygen sensors and tanks of the Divesoft computers.
+#define SAMPLE_NSENSORS 4
+#define SAMPLE_NTANKS   12
+
+// The sample types stored in a row; the parser can skip the others.
+#define SAMPLE_DATA_TYPES ( \
+    DC_SAMPLE_MASK(DC_SAMPLE_TIME) | DC_SAMPLE_MASK(DC_SAMPLE_DEPTH) | \
+    DC_SAMPLE_MASK(DC_SAMPLE_PRESSURE) | DC_SAMPLE_MASK(DC_SAMPLE_TEMPERATURE) | \
+    DC_SAMPLE_MASK(DC_SAMPLE_BEARING) | DC_SAMPLE_MASK(DC_SAMPLE_SETPOINT) | \
+    DC_SAMPLE_MASK(DC_SAMPLE_PPO2) | DC_SAMPLE_MASK(DC_SAMPLE_CNS) | \
+    DC_SAMPLE_MASK(DC_SAMPLE_DECO) | DC_SAMPLE_MASK(DC_SAMPLE_GASMIX))
+
+// Marks an unsigned field without data.
+#define SAMPLE_UNDEFINED 0xFFFFFFFF
+
+// A struct to hold all the data for a single row in the CSV.
+//
+// Missing values use the same sentinels as before: negative for depth,
+// ppO2, CNS, setpoint and pressure, and -999 for the temperature.
+typedef struct {
+    unsigned int time;
+    double depth;
+    double temperature;
+    // The ppO2 without a sensor number (the value the computer uses),
+    // followed by the individual sensors.
+    double ppo2;
+    double ppo2_sensor[SAMPLE_NSENSORS];
+    double pressure[SAMPLE_NTANKS];
+    double cns;
+    double setpoint;
+    // Separate fields for deco info, since dc_deco_t is not a real type
+    unsigned int deco_type;
+    unsigned int deco_time;
+    double deco_depth;
+    unsigned int tts;
+    unsigned int gasmix;  // SAMPLE_UNDEFINED if not reported
+    unsigned int bearing; // SAMPLE_UNDEFINED if not reported
+    int dirty; // Flag to check if we have data to write
+} sample_data_t;
+
+// Clear a row, before the samples of the next timestamp are collected.
+void sample_data_reset(sample_data_t *sample);
+
+// Store a sample value in its slot of the row. Sample types without a
+// column are ignored. DC_SAMPLE_TIME only sets the time and marks the
+// row as dirty; writing out the previous row is up to the caller.
+void sample_data_update(sample_data_t *sample, dc_sample_type_t type, const dc_sample_value_t *value);
+
+#endif /* SAMPLE_DATA_H */